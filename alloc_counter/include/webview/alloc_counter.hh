@@ -0,0 +1,49 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_ALLOC_COUNTER_HH
+#define WEBVIEW_ALLOC_COUNTER_HH
+
+#include <cstdint>
+
+namespace webview {
+
+struct allocation_stats {
+  std::uint64_t count{};
+  std::uint64_t bytes{};
+};
+
+// Returns the number and total size of the heap allocations made by the
+// current thread so far. Programs that link this library have the global
+// operator new and operator new[] replaced to count allocations, as well as
+// malloc(), calloc() and realloc() where they can be replaced (glibc without
+// sanitizers).
+allocation_stats thread_allocation_stats() noexcept;
+
+// Whether allocations through malloc() are counted.
+bool counts_malloc() noexcept;
+
+} // namespace webview
+
+#endif // WEBVIEW_ALLOC_COUNTER_HH
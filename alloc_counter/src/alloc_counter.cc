@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "webview/alloc_counter.hh"
+
+#include <cstdlib>
+#include <new>
+
+// malloc() is only replaced with glibc, which exposes the underlying
+// allocator, and not when a sanitizer already intercepts it.
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) ||    \
+    __has_feature(memory_sanitizer)
+#define WEBVIEW_ALLOC_COUNTER_SANITIZED
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define WEBVIEW_ALLOC_COUNTER_SANITIZED
+#endif
+#if defined(__GLIBC__) && !defined(WEBVIEW_ALLOC_COUNTER_SANITIZED)
+#define WEBVIEW_ALLOC_COUNTER_COUNT_MALLOC
+#endif
+
+namespace {
+
+// Per-thread so that measurements are not disturbed by other threads, and
+// trivially destructible so that they can be used at any time from within
+// malloc().
+thread_local std::uint64_t allocation_count{};
+thread_local std::uint64_t allocation_bytes{};
+
+void count_allocation(std::size_t size) noexcept {
+  ++allocation_count;
+  allocation_bytes += size;
+}
+
+} // namespace
+
+#ifdef WEBVIEW_ALLOC_COUNTER_COUNT_MALLOC
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *p, std::size_t size);
+
+void *malloc(std::size_t size) __THROW {
+  count_allocation(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size) __THROW {
+  count_allocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, std::size_t size) __THROW {
+  if (size > 0) {
+    count_allocation(size);
+  }
+  return __libc_realloc(p, size);
+}
+}
+#endif
+
+void *operator new(std::size_t size) {
+#ifndef WEBVIEW_ALLOC_COUNTER_COUNT_MALLOC
+  // Otherwise counted by malloc().
+  count_allocation(size);
+#endif
+  if (auto *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+// Replaced explicitly since some runtimes, e.g. sanitizers, do not implement
+// it in terms of operator new.
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t /*size*/) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::size_t /*size*/) noexcept {
+  std::free(p);
+}
+
+namespace webview {
+
+allocation_stats thread_allocation_stats() noexcept {
+  allocation_stats stats;
+  stats.count = allocation_count;
+  stats.bytes = allocation_bytes;
+  return stats;
+}
+
+bool counts_malloc() noexcept {
+#ifdef WEBVIEW_ALLOC_COUNTER_COUNT_MALLOC
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace webview
@@ -0,0 +1,143 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_BENCH_DRIVER_HH
+#define WEBVIEW_BENCH_DRIVER_HH
+
+#include "webview/alloc_counter.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace webview {
+
+// Passed to benchmarks, which run the code to measure in a loop:
+//
+//   BENCHMARK("name") {
+//     // Setup that isn't measured
+//     while (state.keep_running()) {
+//       // Code to measure
+//     }
+//   }
+//
+// Only the loop is timed, and memory allocations are only counted within it,
+// on the thread that runs the benchmark (see thread_allocation_stats()).
+class bench_state {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit bench_state(std::uint64_t iterations) noexcept
+      : m_iterations{iterations} {}
+
+  bool keep_running() {
+    if (!m_is_started) {
+      start();
+    }
+    if (m_remaining == 0) {
+      stop();
+      return false;
+    }
+    --m_remaining;
+    return true;
+  }
+
+  std::uint64_t iterations() const noexcept { return m_iterations; }
+  // Whether the benchmark has run all iterations of its loop.
+  bool is_finished() const noexcept { return m_is_finished; }
+  clock::duration elapsed() const noexcept { return m_elapsed; }
+  std::uint64_t allocations() const noexcept { return m_allocations; }
+
+private:
+  void start();
+  void stop();
+
+  std::uint64_t m_iterations;
+  std::uint64_t m_remaining{m_iterations};
+  bool m_is_started{};
+  bool m_is_finished{};
+  clock::time_point m_start;
+  clock::duration m_elapsed{};
+  std::uint64_t m_start_allocations{};
+  std::uint64_t m_allocations{};
+};
+
+// Prevents the compiler from optimizing away the computation of a value.
+template <typename T> void do_not_optimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "m"(value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+class bench_reg {
+public:
+  bench_reg() = default;
+
+  bench_reg(const char *name, std::function<void(bench_state &)> fn) noexcept
+      : m_name{name}, m_fn{std::move(fn)} {}
+
+  const std::string &name() const noexcept { return m_name; }
+  void invoke(bench_state &state) const { m_fn(state); }
+
+private:
+  std::string m_name;
+  std::function<void(bench_state &)> m_fn;
+};
+
+struct auto_bench_reg {
+  explicit auto_bench_reg(bench_reg reg) noexcept {
+    benchmarks()[reg.name()] = std::move(reg);
+  }
+
+  static std::map<std::string, bench_reg> &benchmarks();
+};
+
+// NOLINTBEGIN(cppcoreguidelines-macro-usage, misc-use-anonymous-namespace)
+
+#define MAKE_BENCHMARK_NAME2(name, counter) name##counter
+#define MAKE_BENCHMARK_NAME(name, counter) MAKE_BENCHMARK_NAME2(name, counter)
+
+#define BENCHMARK_INTERNAL(name, counter)                                      \
+  static void MAKE_BENCHMARK_NAME(webview_bench_driver_case_, counter)(        \
+      ::webview::bench_state & state);                                         \
+  namespace {                                                                  \
+  const ::webview::auto_bench_reg                                              \
+      MAKE_BENCHMARK_NAME(webview_bench_driver_case_reg_, counter){            \
+          {name, MAKE_BENCHMARK_NAME(webview_bench_driver_case_, counter)}};   \
+  }                                                                            \
+  static void MAKE_BENCHMARK_NAME(webview_bench_driver_case_, counter)(        \
+      ::webview::bench_state & state)
+
+#define BENCHMARK(name) BENCHMARK_INTERNAL(name, __LINE__)
+
+// NOLINTEND(cppcoreguidelines-macro-usage, misc-use-anonymous-namespace)
+
+} // namespace webview
+
+#endif // WEBVIEW_BENCH_DRIVER_HH
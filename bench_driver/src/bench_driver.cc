@@ -0,0 +1,311 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "webview/bench_driver.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace webview {
+
+std::map<std::string, bench_reg> &auto_bench_reg::benchmarks() {
+  static std::map<std::string, bench_reg> instance;
+  return instance;
+}
+
+void bench_state::start() {
+  m_is_started = true;
+  m_start_allocations = thread_allocation_stats().count;
+  m_start = clock::now();
+}
+
+void bench_state::stop() {
+  if (m_is_finished) {
+    return;
+  }
+  m_elapsed = clock::now() - m_start;
+  m_allocations = thread_allocation_stats().count - m_start_allocations;
+  m_is_finished = true;
+}
+
+} // namespace webview
+
+struct failure_exit_codes {
+  enum type {
+    success = 0,
+    failure = 1,
+    exception_thrown = 2,
+    no_benchmarks_found = 3,
+    benchmark_not_found = 4
+  };
+};
+
+struct options {
+  // Minimum duration of each sample, which decides the number of iterations.
+  std::chrono::milliseconds min_sample_time{10};
+  // Time spent running the benchmark before measuring.
+  std::chrono::milliseconds warm_up_time{100};
+  unsigned int samples{30};
+  std::string json_path;
+  std::vector<std::string> names;
+};
+
+struct bench_result {
+  std::string name;
+  std::uint64_t iterations{};
+  unsigned int samples{};
+  double mean_ns{};
+  double median_ns{};
+  double p99_ns{};
+  double allocs_per_iter{};
+  // Time per iteration of each sample, for comparisons against a baseline.
+  std::vector<double> sample_ns;
+};
+
+webview::bench_state run_sample(const webview::bench_reg &bench,
+                                std::uint64_t iterations) {
+  webview::bench_state state{iterations};
+  bench.invoke(state);
+  if (!state.is_finished()) {
+    throw std::runtime_error{"the benchmark did not run its loop"};
+  }
+  return state;
+}
+
+// Grows the number of iterations until a sample takes at least the minimum
+// sample time.
+std::uint64_t calibrate(const webview::bench_reg &bench,
+                        const options &opts) {
+  using namespace std::chrono;
+  std::uint64_t iterations = 1;
+  for (;;) {
+    auto elapsed = run_sample(bench, iterations).elapsed();
+    if (elapsed >= opts.min_sample_time || iterations >= (1ULL << 32)) {
+      return iterations;
+    }
+    auto ns = static_cast<double>(duration_cast<nanoseconds>(elapsed).count());
+    auto target =
+        static_cast<double>(nanoseconds{opts.min_sample_time}.count()) * 1.2;
+    // Grow by at most 10x at a time since the first samples are the noisiest.
+    auto factor = ns > 0 ? std::min(target / ns, 10.0) : 10.0;
+    iterations = std::max(iterations + 1,
+                          static_cast<std::uint64_t>(
+                              static_cast<double>(iterations) * factor));
+  }
+}
+
+double percentile(const std::vector<double> &sorted, double percent) {
+  auto rank = static_cast<std::size_t>(
+      std::ceil(percent / 100 * static_cast<double>(sorted.size())));
+  return sorted[std::min(std::max(rank, std::size_t{1}), sorted.size()) - 1];
+}
+
+bench_result run_benchmark(const webview::bench_reg &bench,
+                           const options &opts) {
+  using namespace std::chrono;
+  auto iterations = calibrate(bench, opts);
+  auto warm_up_end = steady_clock::now() + opts.warm_up_time;
+  while (steady_clock::now() < warm_up_end) {
+    run_sample(bench, iterations);
+  }
+  std::vector<double> ns_per_iter;
+  std::uint64_t allocations{};
+  for (unsigned int i = 0; i < opts.samples; ++i) {
+    auto state = run_sample(bench, iterations);
+    ns_per_iter.push_back(
+        static_cast<double>(duration_cast<nanoseconds>(state.elapsed()).count()) /
+        static_cast<double>(iterations));
+    allocations += state.allocations();
+  }
+  std::sort(ns_per_iter.begin(), ns_per_iter.end());
+  bench_result result;
+  result.name = bench.name();
+  result.iterations = iterations;
+  result.samples = opts.samples;
+  for (auto ns : ns_per_iter) {
+    result.mean_ns += ns / static_cast<double>(ns_per_iter.size());
+  }
+  result.median_ns = percentile(ns_per_iter, 50);
+  result.p99_ns = percentile(ns_per_iter, 99);
+  result.allocs_per_iter =
+      static_cast<double>(allocations) /
+      (static_cast<double>(iterations) * static_cast<double>(opts.samples));
+  result.sample_ns = std::move(ns_per_iter);
+  return result;
+}
+
+std::string json_string(const std::string &s) {
+  std::string json{"\""};
+  for (auto c : s) {
+    if (c == '"' || c == '\\') {
+      json += '\\';
+    }
+    json += c;
+  }
+  return json + '"';
+}
+
+bool write_json(const std::string &path,
+                const std::vector<bench_result> &results) {
+  std::ofstream out{path};
+  out << "{\"benchmarks\":[";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    char numbers[256];
+    std::snprintf(numbers, sizeof(numbers),
+                  "\"mean_ns\":%.3f,\"median_ns\":%.3f,\"p99_ns\":%.3f,"
+                  "\"allocs_per_iter\":%.3f",
+                  r.mean_ns, r.median_ns, r.p99_ns, r.allocs_per_iter);
+    out << (i ? "," : "") << "\n{\"name\":" << json_string(r.name)
+        << ",\"iterations\":" << r.iterations << ",\"samples\":" << r.samples
+        << ',' << numbers << ",\"sample_ns\":[";
+    for (std::size_t j = 0; j < r.sample_ns.size(); ++j) {
+      std::snprintf(numbers, sizeof(numbers), "%s%.3f", j ? "," : "",
+                    r.sample_ns[j]);
+      out << numbers;
+    }
+    out << "]}";
+  }
+  out << "\n]}\n";
+  return static_cast<bool>(out);
+}
+
+int cmd_help() {
+  std::cout << "Usage: program [--help|--list] [--json file] [--samples n] "
+               "[--min-time ms] [--warm-up ms] [benchmark_name...].\n";
+  return 0;
+}
+
+int cmd_list() {
+  using namespace webview;
+  auto &benchmarks{auto_bench_reg::benchmarks()};
+  if (benchmarks.empty()) {
+    std::cerr << "No benchmarks found.\n";
+    return failure_exit_codes::no_benchmarks_found;
+  }
+  for (const auto &bench : benchmarks) {
+    std::cout << bench.second.name() << '\n';
+  }
+  return failure_exit_codes::success;
+}
+
+int cmd_run(const options &opts) {
+  using namespace webview;
+  auto &benchmarks{auto_bench_reg::benchmarks()};
+  if (benchmarks.empty()) {
+    std::cerr << "No benchmarks found.\n";
+    return failure_exit_codes::no_benchmarks_found;
+  }
+  std::vector<const bench_reg *> selected;
+  for (const auto &name : opts.names) {
+    auto found{benchmarks.find(name)};
+    if (found == benchmarks.end()) {
+      std::cerr << "Benchmark not found: " << name << '\n';
+      return failure_exit_codes::benchmark_not_found;
+    }
+    selected.push_back(&found->second);
+  }
+  if (selected.empty()) {
+    for (const auto &it : benchmarks) {
+      selected.push_back(&it.second);
+    }
+  }
+  auto exit_code{failure_exit_codes::success};
+  std::vector<bench_result> results;
+  std::printf("%-32s %12s %12s %12s %12s %12s\n", "benchmark", "iterations",
+              "mean ns", "median ns", "p99 ns", "allocs/iter");
+  for (const auto *bench : selected) {
+    try {
+      auto r = run_benchmark(*bench, opts);
+      std::printf("%-32s %12llu %12.1f %12.1f %12.1f %12.2f\n",
+                  r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+                  r.mean_ns, r.median_ns, r.p99_ns, r.allocs_per_iter);
+      results.push_back(r);
+    } catch (const std::exception &e) {
+      std::printf("%-32s FAIL\n", bench->name().c_str());
+      std::cerr << "Benchmark \"" << bench->name()
+                << "\" threw exception with message \"" << e.what()
+                << "\".\n";
+      exit_code = failure_exit_codes::failure;
+    }
+  }
+  if (!opts.json_path.empty() && !write_json(opts.json_path, results)) {
+    std::cerr << "Failed to write " << opts.json_path << '\n';
+    exit_code = failure_exit_codes::failure;
+  }
+  return exit_code;
+}
+
+int main(int argc, const char *argv[]) {
+  try {
+    std::deque<std::string> args{argv + 1, argv + argc};
+    options opts;
+    while (!args.empty()) {
+      auto arg{args.front()};
+      args.pop_front();
+      if (arg == "--help") {
+        return cmd_help();
+      }
+      if (arg == "--list") {
+        return cmd_list();
+      }
+      if (arg == "--json" || arg == "--samples" || arg == "--min-time" ||
+          arg == "--warm-up") {
+        if (args.empty()) {
+          cmd_help();
+          return failure_exit_codes::failure;
+        }
+        auto value{args.front()};
+        args.pop_front();
+        if (arg == "--json") {
+          opts.json_path = value;
+        } else if (arg == "--samples") {
+          opts.samples = static_cast<unsigned int>(
+              std::max(std::stoul(value), 1UL));
+        } else if (arg == "--min-time") {
+          opts.min_sample_time = std::chrono::milliseconds{std::stoll(value)};
+        } else {
+          opts.warm_up_time = std::chrono::milliseconds{std::stoll(value)};
+        }
+        continue;
+      }
+      opts.names.push_back(arg);
+    }
+    return cmd_run(opts);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return failure_exit_codes::exception_thrown;
+  } catch (...) {
+    std::cerr << "Unknown error.\n";
+    return failure_exit_codes::exception_thrown;
+  }
+}
@@ -141,7 +141,7 @@ macro(webview_init)
         endif()
     endif()
 
-    if(WEBVIEW_BUILD)
+    if(WEBVIEW_BUILD AND NOT WEBVIEW_USE_NULL_BACKEND)
         webview_find_dependencies()
     endif()
 endmacro()
@@ -245,6 +245,11 @@ macro(webview_install_targets)
         DESTINATION "${CMAKE_INSTALL_LIBDIR}/cmake/webview"
         COMPONENT webview_cmake)
 
+    # Install tools used by CMake functions
+    install(DIRECTORY "${WEBVIEW_CURRENT_CMAKE_DIR}/tools"
+        DESTINATION "${CMAKE_INSTALL_LIBDIR}/cmake/webview"
+        COMPONENT webview_cmake)
+
     # Install targets
     list(APPEND WEBVIEW_INSTALL_TARGET_NAMES webview_core_headers)
 
@@ -329,16 +334,20 @@ macro(webview_internal_options)
     option(WEBVIEW_BUILD_DOCS "Build documentation" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
     option(WEBVIEW_BUILD_TESTS "Build tests" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
     option(WEBVIEW_BUILD_EXAMPLES "Build examples" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
+    option(WEBVIEW_BUILD_BENCHMARKS "Build benchmarks" OFF)
     option(WEBVIEW_INSTALL_DOCS "Install documentation" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
     option(WEBVIEW_INSTALL_TARGETS "Install targets" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
     option(WEBVIEW_BUILD_SHARED_LIBRARY "Build shared libraries" ON)
     option(WEBVIEW_BUILD_STATIC_LIBRARY "Build static libraries" ON)
     option(WEBVIEW_USE_COMPAT_MINGW "Use compatibility helper for MinGW" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
     option(WEBVIEW_USE_STATIC_MSVC_RUNTIME "Use static runtime library (MSVC)" OFF)
+    option(WEBVIEW_USE_NULL_BACKEND "Use the null backend instead of a browser engine" OFF)
     option(WEBVIEW_ENABLE_CHECKS "Enable checks" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
     option(WEBVIEW_ENABLE_CLANG_FORMAT "Enable clang-format" ${WEBVIEW_ENABLE_CHECKS})
     option(WEBVIEW_ENABLE_CLANG_TIDY "Enable clang-tidy" ${WEBVIEW_ENABLE_CHECKS})
     option(WEBVIEW_ENABLE_PACKAGING "Enable packaging" ${WEBVIEW_IS_TOP_LEVEL_BUILD})
+    option(WEBVIEW_ENABLE_USDT "Enable USDT probes" OFF)
+    option(WEBVIEW_ENABLE_GTK_STRUCTURED_MESSAGES "Enable structured binding messages (GTK)" OFF)
     option(WEBVIEW_STRICT_CHECKS "Make checks strict" ${WEBVIEW_IS_CI})
     cmake_dependent_option(WEBVIEW_PACKAGE_AMALGAMATION "Package amalgamated library" ON WEBVIEW_ENABLE_PACKAGING OFF)
     cmake_dependent_option(WEBVIEW_PACKAGE_DOCS "Package documentation" ON WEBVIEW_ENABLE_PACKAGING OFF)
@@ -346,6 +355,8 @@ macro(webview_internal_options)
     cmake_dependent_option(WEBVIEW_PACKAGE_LIB "Package compiled libraries" ON WEBVIEW_ENABLE_PACKAGING OFF)
     option(WEBVIEW_STRICT_CLANG_FORMAT "Make clang-format check strict" ${WEBVIEW_STRICT_CHECKS})
     option(WEBVIEW_STRICT_CLANG_TIDY "Make clang-tidy check strict" ${WEBVIEW_STRICT_CHECKS})
+    set(WEBVIEW_BENCHMARK_BASELINE_DIR "" CACHE PATH "Directory with baseline benchmark results")
+    set(WEBVIEW_BENCHMARK_THRESHOLD 5 CACHE STRING "Smallest slowdown in percent to treat as a benchmark regression")
 endmacro()
 
 macro(webview_set_install_rpath)
@@ -0,0 +1,219 @@
+"""Packs a directory of web assets into a bundle for webview's asset_bundle.
+
+The format is described in core/include/webview/detail/asset_bundle.hh.
+"""
+
+from argparse import ArgumentParser
+import gzip
+import hashlib
+import mimetypes
+import os
+import pathlib
+import struct
+from typing import List, Optional, Tuple
+
+MAGIC = b"WVAB"
+VERSION = 1
+HEADER_SIZE = 16
+INDEX_ENTRY_SIZE = 48
+FLAG_GZIP = 1
+DATA_ALIGNMENT = 16
+
+# Common web MIME types that may be missing or wrong in the system database.
+MIME_TYPES = {
+    ".css": "text/css",
+    ".gif": "image/gif",
+    ".htm": "text/html",
+    ".html": "text/html",
+    ".ico": "image/x-icon",
+    ".jpeg": "image/jpeg",
+    ".jpg": "image/jpeg",
+    ".js": "text/javascript",
+    ".json": "application/json",
+    ".map": "application/json",
+    ".mjs": "text/javascript",
+    ".mp3": "audio/mpeg",
+    ".mp4": "video/mp4",
+    ".ogg": "audio/ogg",
+    ".otf": "font/otf",
+    ".pdf": "application/pdf",
+    ".png": "image/png",
+    ".svg": "image/svg+xml",
+    ".ttf": "font/ttf",
+    ".txt": "text/plain",
+    ".wasm": "application/wasm",
+    ".wav": "audio/wav",
+    ".webm": "video/webm",
+    ".webp": "image/webp",
+    ".woff": "font/woff",
+    ".woff2": "font/woff2",
+    ".xml": "application/xml",
+}
+
+COMPRESSIBLE_MIME_TYPES = {
+    "application/json",
+    "application/wasm",
+    "application/xml",
+    "image/svg+xml",
+    "image/x-icon",
+}
+
+
+def guess_mime_type(path: pathlib.Path) -> str:
+    mime_type = MIME_TYPES.get(path.suffix.lower())
+    if mime_type is None:
+        mime_type = mimetypes.guess_type(path.name)[0]
+    return mime_type or "application/octet-stream"
+
+
+def is_compressible(mime_type: str) -> bool:
+    return (mime_type.startswith("text/") or
+            mime_type in COMPRESSIBLE_MIME_TYPES)
+
+
+def hash64(data: bytes) -> int:
+    digest = hashlib.blake2b(data, digest_size=8).digest()
+    return int.from_bytes(digest, "little")
+
+
+def align(n: int) -> int:
+    return (n + DATA_ALIGNMENT - 1) // DATA_ALIGNMENT * DATA_ALIGNMENT
+
+
+Entry = Tuple[bytes, bytes, bytes, int, int]
+
+
+def collect_entries(input_dir: pathlib.Path, compress: bool) -> List[Entry]:
+    entries = []
+    for root, dirs, files in os.walk(input_dir):
+        dirs.sort()
+        for name in files:
+            file_path = pathlib.Path(root) / name
+            path = file_path.relative_to(input_dir).as_posix().encode("utf-8")
+            mime_type = guess_mime_type(file_path)
+            content = file_path.read_bytes()
+            flags = 0
+            data = content
+            if compress and is_compressible(mime_type):
+                compressed = gzip.compress(content, compresslevel=9, mtime=0)
+                # Only keep the compressed data if it's worth decompressing.
+                if len(compressed) < len(content) * 0.9:
+                    data = compressed
+                    flags |= FLAG_GZIP
+            entries.append((path, mime_type.encode("utf-8"), data,
+                            hash64(content), flags))
+    # The reader looks up paths with a binary search.
+    entries.sort(key=lambda e: e[0])
+    return entries
+
+
+def build_bundle(entries: List[Entry]) -> bytes:
+    strings = bytearray()
+    string_offsets = []
+    strings_start = HEADER_SIZE + INDEX_ENTRY_SIZE * len(entries)
+    for path, mime_type, _, _, _ in entries:
+        path_offset = strings_start + len(strings)
+        strings += path
+        mime_offset = strings_start + len(strings)
+        strings += mime_type
+        string_offsets.append((path_offset, mime_offset))
+
+    data = bytearray()
+    data_start = align(strings_start + len(strings))
+    data_offsets = []
+    for _, _, content, _, _ in entries:
+        data += b"\0" * (align(len(data)) - len(data))
+        data_offsets.append(data_start + len(data))
+        data += content
+
+    out = bytearray()
+    out += struct.pack("<4sIII", MAGIC, VERSION, len(entries), 0)
+    for entry, string_offset, data_offset in zip(entries, string_offsets,
+                                                 data_offsets):
+        path, mime_type, content, content_hash, flags = entry
+        path_offset, mime_offset = string_offset
+        out += struct.pack("<IIIIQQQII", path_offset, len(path), mime_offset,
+                           len(mime_type), data_offset, len(content),
+                           content_hash, flags, 0)
+    out += strings
+    out += b"\0" * (data_start - len(out))
+    out += data
+    return bytes(out)
+
+
+def write_if_changed(path: pathlib.Path, content: bytes):
+    if path.exists() and path.read_bytes() == content:
+        # Keep the content but mark the output as up to date so that the
+        # build system does not run the packer again on every build.
+        path.touch()
+        return
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_bytes(content)
+
+
+def write_c_files(bundle: bytes, source: pathlib.Path, header: pathlib.Path,
+                  symbol: str):
+    guard = symbol.upper() + "_H"
+    write_if_changed(header, f"""/* Generated by pack_assets.py. Do not edit. */
+#ifndef {guard}
+#define {guard}
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {{
+#endif
+
+extern const unsigned char {symbol}[];
+extern const size_t {symbol}_size;
+
+#ifdef __cplusplus
+}}
+#endif
+
+#endif /* {guard} */
+""".encode("utf-8"))
+    lines = []
+    for i in range(0, len(bundle), 16):
+        lines.append(",".join(str(b) for b in bundle[i:i + 16]))
+    write_if_changed(source, f"""/* Generated by pack_assets.py. Do not edit. */
+#include "{header.name}"
+
+const unsigned char {symbol}[] = {{
+{(','+chr(10)).join(lines)}
+}};
+
+const size_t {symbol}_size = sizeof({symbol});
+""".encode("utf-8"))
+
+
+def main(args: Optional[List[str]] = None):
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("--input", type=pathlib.Path, required=True,
+                        help="Directory of assets to pack")
+    parser.add_argument("--output", type=pathlib.Path, required=True,
+                        help="Bundle file to write")
+    parser.add_argument("--compress", action="store_true",
+                        help="Compress text assets with gzip")
+    parser.add_argument("--c-source", type=pathlib.Path,
+                        help="C++ source file defining the bundle as an array")
+    parser.add_argument("--c-header", type=pathlib.Path,
+                        help="Header file declaring the array")
+    parser.add_argument("--symbol", default="webview_asset_bundle",
+                        help="Name of the array")
+    options = parser.parse_args(args)
+
+    if not options.input.is_dir():
+        parser.error(f"Not a directory: {options.input}")
+    if (options.c_source is None) != (options.c_header is None):
+        parser.error("--c-source and --c-header must be used together")
+
+    bundle = build_bundle(collect_entries(options.input, options.compress))
+    write_if_changed(options.output, bundle)
+    if options.c_source is not None:
+        write_c_files(bundle, options.c_source, options.c_header,
+                      options.symbol)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,3 +1,6 @@
+# Used by webview_add_asset_bundle()
+set(WEBVIEW_ASSET_PACKER "${CMAKE_CURRENT_LIST_DIR}/tools/pack_assets.py")
+
 macro(webview_options)
     if(CMAKE_SYSTEM_NAME STREQUAL "Windows")
         set(WEBVIEW_MSWEBVIEW2_VERSION "1.0.1150.38" CACHE STRING "MS WebView2 version")
@@ -91,3 +94,65 @@ function(webview_fetch_mswebview2 VERSION)
     set(MSWebView2_ROOT "${MSWebView2_ROOT}" PARENT_SCOPE)
     cmake_policy(POP)
 endfunction()
+
+# Packs a directory of web assets into a bundle that can be served on a custom
+# URI scheme with serve_asset_bundle().
+#
+# webview_add_asset_bundle(<target> DIRECTORY <dir> [COMPRESS] [EMBED]
+#                          [OUTPUT <file>] [SYMBOL <name>])
+#
+# COMPRESS stores text assets compressed with gzip when it saves space.
+#
+# Without EMBED, <target> is a custom target that writes the bundle to OUTPUT
+# (<target>.wvab in the current binary directory by default) so that it can be
+# memory-mapped with asset_bundle::open().
+#
+# With EMBED, <target> is a static library that defines the bundle as the byte
+# array SYMBOL (<target> by default) and its size as SYMBOL_size, declared in
+# the header <target>.h, for use with asset_bundle::from_memory().
+function(webview_add_asset_bundle TARGET)
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "COMPRESS;EMBED" "DIRECTORY;OUTPUT;SYMBOL" "")
+    if("${ARG_DIRECTORY}" STREQUAL "")
+        message(FATAL_ERROR "webview_add_asset_bundle: DIRECTORY is required")
+    endif()
+    get_filename_component(ARG_DIRECTORY "${ARG_DIRECTORY}" ABSOLUTE)
+    if("${ARG_OUTPUT}" STREQUAL "")
+        set(ARG_OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}.wvab")
+    endif()
+    if("${ARG_SYMBOL}" STREQUAL "")
+        string(MAKE_C_IDENTIFIER "${TARGET}" ARG_SYMBOL)
+    endif()
+
+    find_package(Python3 REQUIRED COMPONENTS Interpreter)
+    file(GLOB_RECURSE ASSET_FILES CONFIGURE_DEPENDS "${ARG_DIRECTORY}/*")
+
+    set(PACK_ARGS --input "${ARG_DIRECTORY}" --output "${ARG_OUTPUT}")
+    set(PACK_OUTPUTS "${ARG_OUTPUT}")
+    if(ARG_COMPRESS)
+        list(APPEND PACK_ARGS --compress)
+    endif()
+    if(ARG_EMBED)
+        set(GENERATED_DIR "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}_asset_bundle")
+        set(GENERATED_SOURCE "${GENERATED_DIR}/${TARGET}.cc")
+        set(GENERATED_HEADER "${GENERATED_DIR}/include/${TARGET}.h")
+        list(APPEND PACK_ARGS
+            --c-source "${GENERATED_SOURCE}"
+            --c-header "${GENERATED_HEADER}"
+            --symbol "${ARG_SYMBOL}")
+        list(APPEND PACK_OUTPUTS "${GENERATED_SOURCE}" "${GENERATED_HEADER}")
+    endif()
+
+    add_custom_command(
+        OUTPUT ${PACK_OUTPUTS}
+        COMMAND ${Python3_EXECUTABLE} "${WEBVIEW_ASSET_PACKER}" ${PACK_ARGS}
+        DEPENDS ${ASSET_FILES} "${WEBVIEW_ASSET_PACKER}"
+        COMMENT "Packing asset bundle ${TARGET}..."
+        VERBATIM)
+
+    if(ARG_EMBED)
+        add_library(${TARGET} STATIC "${GENERATED_SOURCE}" "${GENERATED_HEADER}")
+        target_include_directories(${TARGET} PUBLIC "${GENERATED_DIR}/include")
+    else()
+        add_custom_target(${TARGET} ALL DEPENDS ${PACK_OUTPUTS})
+    endif()
+endfunction()
@@ -0,0 +1,90 @@
+// Benchmarks of the parts of the library that don't depend on a browser
+// engine, run with the null backend.
+//
+// Usage: webview_core_benchmarks [--help]
+
+#include "webview/bench_driver.hh"
+#include "webview/webview.h"
+
+#include <string>
+
+namespace {
+
+// Exposes the generation of the bind script.
+class bench_engine : public webview::detail::null_engine {
+public:
+  using null_engine::create_bind_script;
+};
+
+std::string make_message(std::size_t param_count) {
+  std::string params;
+  for (std::size_t i = 0; i < param_count; ++i) {
+    params += (i ? ",\"" : "\"") + std::string(32, 'a') + "\\n\"";
+  }
+  return R"({"id":"12345","method":"binding_name","params":[)" + params +
+         "]}";
+}
+
+} // namespace
+
+BENCHMARK("json_parse") {
+  using namespace webview::detail;
+  auto message = make_message(8);
+  while (state.keep_running()) {
+    auto params = json_parse(message, "params", 0);
+    webview::do_not_optimize(params);
+  }
+}
+
+BENCHMARK("json_escape") {
+  using namespace webview::detail;
+  std::string value;
+  for (int i = 0; i < 16; ++i) {
+    value += "Text with \"quotes\", a\ttab and a new line\n. ";
+  }
+  while (state.keep_running()) {
+    auto escaped = json_escape(value);
+    webview::do_not_optimize(escaped);
+  }
+}
+
+BENCHMARK("json_unescape") {
+  using namespace webview::detail;
+  std::string value;
+  for (int i = 0; i < 16; ++i) {
+    value += R"(Text with \"quotes\", a\ttab and a new line\n. )";
+  }
+  value = '"' + value + '"';
+  std::string out(value.size() + 1, '\0');
+  while (state.keep_running()) {
+    auto size = json_unescape(value.data(), value.size(), &out[0]);
+    webview::do_not_optimize(size);
+    webview::do_not_optimize(out);
+  }
+}
+
+BENCHMARK("bind_script") {
+  bench_engine w;
+  for (int i = 0; i < 32; ++i) {
+    w.bind("binding_" + std::to_string(i),
+           [](const std::string & /*req*/) -> std::string { return ""; });
+  }
+  while (state.keep_running()) {
+    auto js = w.create_bind_script();
+    webview::do_not_optimize(js);
+  }
+}
+
+BENCHMARK("on_message_resolve") {
+  webview::detail::null_engine w;
+  std::size_t replies{};
+  w.set_script_handler([&](const std::string & /*js*/) { ++replies; });
+  w.bind("binding_name",
+         [](const std::string &req) -> std::string { return req; });
+  auto message = make_message(2);
+  while (state.keep_running()) {
+    w.post_message(message);
+    w.run_pending();
+  }
+  webview::do_not_optimize(replies);
+}
@@ -0,0 +1,406 @@
+// Measures the latency and throughput of calls from JS to a native binding and
+// back through the real browser engine, with payloads from 16 bytes to 16 MiB.
+// Also reports the peak resident set size of this process and, on Linux, of
+// the browser's web process.
+//
+// Usage: webview_roundtrip_benchmark [--concurrency n] [--calls n]
+//                                    [--max-size bytes] [--json file]
+//
+// Latencies are measured in JS with performance.now() and are therefore
+// limited by the resolution of that clock in the browser engine.
+
+#include "webview/webview.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr const auto html = R"html(<!DOCTYPE html>
+<script>
+  const PLAN = PLAN_PLACEHOLDER;
+  function payload(size) {
+    return "0123456789abcdef".repeat(Math.ceil(size / 16)).slice(0, size);
+  }
+  async function measure(size, calls, concurrency) {
+    const data = payload(size);
+    const times = new Array(calls);
+    let next = 0;
+    async function worker() {
+      while (next < calls) {
+        const i = next++;
+        const start = performance.now();
+        const result = await window.echo(data);
+        times[i] = performance.now() - start;
+        if (result[0].length !== size) {
+          throw new Error("Unexpected reply of " + result[0].length + " bytes");
+        }
+      }
+    }
+    const start = performance.now();
+    const workers = [];
+    for (let i = 0; i < Math.min(concurrency, calls); ++i) {
+      workers.push(worker());
+    }
+    await Promise.all(workers);
+    return [times, performance.now() - start];
+  }
+  (async () => {
+    for (const [size, calls, warmUp, concurrency] of PLAN) {
+      await measure(size, warmUp, concurrency);
+      const [times, elapsed] = await measure(size, calls, concurrency);
+      await window.report(size, concurrency, times, elapsed);
+    }
+    window.done();
+  })().catch(e => window.done(e.message));
+</script>)html";
+
+struct options {
+  unsigned int concurrency{8};
+  unsigned int calls{1000};
+  std::size_t max_size{16 * 1024 * 1024};
+  std::string json_file;
+};
+
+struct step {
+  std::size_t size;
+  unsigned int calls;
+  unsigned int warm_up;
+  unsigned int concurrency;
+};
+
+struct result {
+  std::string name;
+  unsigned int calls{};
+  unsigned int concurrency{};
+  double mean_ms{};
+  double median_ms{};
+  double p90_ms{};
+  double p99_ms{};
+  double max_ms{};
+  double calls_per_second{};
+  std::vector<double> times_ms;
+};
+
+// Limits the amount of data sent per payload size so that the largest
+// payloads finish in reasonable time and memory.
+constexpr std::size_t bytes_per_step = 512 * 1024 * 1024;
+// Limits the amount of data in flight at once.
+constexpr std::size_t bytes_in_flight = 128 * 1024 * 1024;
+
+std::vector<step> make_plan(const options &opts) {
+  std::vector<step> plan;
+  for (std::size_t size = 16; size <= opts.max_size; size *= 16) {
+    step s{};
+    s.size = size;
+    s.calls = static_cast<unsigned int>(std::max<std::size_t>(
+        16, std::min<std::size_t>(opts.calls, bytes_per_step / size)));
+    s.warm_up = std::max(1U, s.calls / 10);
+    s.concurrency = static_cast<unsigned int>(std::max<std::size_t>(
+        1, std::min<std::size_t>(opts.concurrency, bytes_in_flight / size)));
+    plan.push_back(s);
+  }
+  return plan;
+}
+
+std::string plan_to_json(const std::vector<step> &plan) {
+  std::string json = "[";
+  for (const auto &s : plan) {
+    if (json.size() > 1) {
+      json += ',';
+    }
+    json += '[' + std::to_string(s.size) + ',' + std::to_string(s.calls) +
+            ',' + std::to_string(s.warm_up) + ',' +
+            std::to_string(s.concurrency) + ']';
+  }
+  return json + ']';
+}
+
+std::string size_label(std::size_t size) {
+  if (size >= 1024 * 1024) {
+    return std::to_string(size / (1024 * 1024)) + "MiB";
+  }
+  if (size >= 1024) {
+    return std::to_string(size / 1024) + "KiB";
+  }
+  return std::to_string(size) + "B";
+}
+
+// Nearest-rank percentile of sorted values.
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto count = static_cast<double>(sorted.size());
+  auto rank = static_cast<std::size_t>(p / 100 * count + 0.5);
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+result make_result(std::size_t size, unsigned int concurrency,
+                   std::vector<double> times, double elapsed_ms) {
+  std::sort(times.begin(), times.end());
+  result r;
+  r.name = "roundtrip/" + size_label(size);
+  r.calls = static_cast<unsigned int>(times.size());
+  r.concurrency = concurrency;
+  double sum = 0;
+  for (auto t : times) {
+    sum += t;
+  }
+  if (!times.empty()) {
+    auto middle = times.size() / 2;
+    r.mean_ms = sum / static_cast<double>(times.size());
+    r.median_ms = times.size() % 2
+                      ? times[middle]
+                      : (times[middle - 1] + times[middle]) / 2;
+    r.max_ms = times.back();
+  }
+  r.p90_ms = percentile(times, 90);
+  r.p99_ms = percentile(times, 99);
+  r.calls_per_second =
+      elapsed_ms > 0 ? static_cast<double>(times.size()) / (elapsed_ms / 1000)
+                     : 0;
+  r.times_ms = std::move(times);
+  return r;
+}
+
+std::vector<double> parse_times(const std::string &json) {
+  std::vector<double> times;
+  for (int i = 0;; ++i) {
+    auto value = webview::detail::json_parse(json, "", i);
+    if (value.empty()) {
+      break;
+    }
+    // GTK sets the C locale from the environment, which strtod() obeys.
+    times.push_back(webview::detail::json_parse_number(value));
+  }
+  return times;
+}
+
+// Peak RSS of this process in KiB.
+long app_peak_rss_kib() {
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+std::string read_file(const std::string &path) {
+  std::ifstream stream{path};
+  std::stringstream ss;
+  ss << stream.rdbuf();
+  return ss.str();
+}
+
+// Reads a field such as "PPid" or "VmHWM" from /proc/<pid>/status.
+long proc_status_field(const std::string &pid, const std::string &field) {
+  auto status = read_file("/proc/" + pid + "/status");
+  auto pos = status.find('\n' + field + ':');
+  if (pos == std::string::npos) {
+    return -1;
+  }
+  return std::strtol(status.c_str() + pos + field.size() + 2, nullptr, 10);
+}
+
+bool is_descendant(const std::string &pid) {
+  auto self = static_cast<long>(getpid());
+  auto current = pid;
+  // The web process may be spawned through a sandbox launcher.
+  for (int depth = 0; depth < 8; ++depth) {
+    auto ppid = proc_status_field(current, "PPid");
+    if (ppid <= 1) {
+      return false;
+    }
+    if (ppid == self) {
+      return true;
+    }
+    current = std::to_string(ppid);
+  }
+  return false;
+}
+
+// Peak RSS in KiB of the largest web process spawned by this process, or -1
+// if it cannot be determined.
+long web_process_peak_rss_kib() {
+  long peak = -1;
+  auto *dir = opendir("/proc");
+  if (!dir) {
+    return peak;
+  }
+  while (auto *entry = readdir(dir)) {
+    std::string pid{entry->d_name};
+    if (pid.find_first_not_of("0123456789") != std::string::npos) {
+      continue;
+    }
+    // The command name is truncated to 15 characters.
+    auto comm = read_file("/proc/" + pid + "/comm");
+    if (comm.compare(0, 15, "WebKitWebProces") != 0 || !is_descendant(pid)) {
+      continue;
+    }
+    peak = std::max(peak, proc_status_field(pid, "VmHWM"));
+  }
+  closedir(dir);
+  return peak;
+}
+
+void print_result(const result &r) {
+  std::printf("%-18s %6u %4u %9.3f %9.3f %9.3f %9.3f %9.3f %10.1f\n",
+              r.name.c_str(), r.calls, r.concurrency, r.mean_ms, r.median_ms,
+              r.p90_ms, r.p99_ms, r.max_ms, r.calls_per_second);
+}
+
+bool write_json(const std::string &path, const std::vector<result> &results,
+                long app_rss, long web_rss) {
+  std::ofstream out{path};
+  if (!out) {
+    return false;
+  }
+  out.imbue(std::locale::classic());
+  auto ns = [](double ms) { return static_cast<long long>(ms * 1e6); };
+  out << "{\"benchmarks\":[";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    out << (i > 0 ? "," : "")
+        << "{\"name\":" << webview::detail::json_escape(r.name)
+        << ",\"iterations\":" << r.calls << ",\"samples\":" << r.calls
+        << ",\"concurrency\":" << r.concurrency
+        << ",\"mean_ns\":" << ns(r.mean_ms)
+        << ",\"median_ns\":" << ns(r.median_ms)
+        << ",\"p90_ns\":" << ns(r.p90_ms) << ",\"p99_ns\":" << ns(r.p99_ms)
+        << ",\"max_ns\":" << ns(r.max_ms)
+        << ",\"calls_per_second\":" << r.calls_per_second
+        << ",\"sample_ns\":[";
+    for (std::size_t j = 0; j < r.times_ms.size(); ++j) {
+      out << (j > 0 ? "," : "") << ns(r.times_ms[j]);
+    }
+    out << "]}";
+  }
+  out << "],\"peak_rss_kib\":{\"app\":" << app_rss
+      << ",\"web_process\":" << web_rss << "}}\n";
+  return static_cast<bool>(out);
+}
+
+void print_usage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--concurrency n] [--calls n] [--max-size bytes]"
+               " [--json file]\n";
+}
+
+bool parse_options(int argc, char *argv[], options &opts) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{argv[i]};
+    if (i + 1 >= argc) {
+      return false;
+    }
+    std::string value{argv[++i]};
+    if (arg == "--json") {
+      opts.json_file = value;
+      continue;
+    }
+    auto number = std::strtoul(value.c_str(), nullptr, 10);
+    if (number == 0) {
+      return false;
+    }
+    if (arg == "--concurrency") {
+      opts.concurrency = static_cast<unsigned int>(number);
+    } else if (arg == "--calls") {
+      opts.calls = static_cast<unsigned int>(number);
+    } else if (arg == "--max-size") {
+      opts.max_size = number;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  options opts;
+  if (!parse_options(argc, argv, opts)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // Keep results comparable between machines with and without a GPU, and
+  // allow running under Xvfb. Explicit settings in the environment win.
+  setenv("WEBKIT_DISABLE_COMPOSITING_MODE", "1", 0);
+  setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+
+  auto plan = make_plan(opts);
+  auto page = std::string{html};
+  auto placeholder = page.find("PLAN_PLACEHOLDER");
+  page.replace(placeholder, 16, plan_to_json(plan));
+
+  int status = 0;
+  std::vector<result> results;
+  long web_rss = -1;
+  try {
+    webview::webview w(false, nullptr);
+    w.bind(
+        "echo",
+        [&](const std::string &id, const std::string &req, void *) {
+          w.resolve(id, 0, req);
+        },
+        nullptr);
+    w.bind("report", [&](const std::string &req) -> std::string {
+      auto size = std::stoull(webview::detail::json_parse(req, "", 0));
+      auto concurrency = std::stoul(webview::detail::json_parse(req, "", 1));
+      auto times = parse_times(webview::detail::json_parse(req, "", 2));
+      auto elapsed = webview::detail::json_parse_number(
+          webview::detail::json_parse(req, "", 3));
+      results.push_back(make_result(static_cast<std::size_t>(size),
+                                    static_cast<unsigned int>(concurrency),
+                                    std::move(times), elapsed));
+      print_result(results.back());
+      return "";
+    });
+    w.bind("done", [&](const std::string &req) -> std::string {
+      auto error = webview::detail::json_parse(req, "", 0);
+      if (!error.empty()) {
+        std::cerr << error << '\n';
+        status = 1;
+      }
+      // Sample before the web process goes away.
+      web_rss = web_process_peak_rss_kib();
+      w.terminate();
+      return "";
+    });
+    std::printf("%-18s %6s %4s %9s %9s %9s %9s %9s %10s\n", "Payload",
+                "Calls", "Conc", "Mean ms", "Median", "p90", "p99", "Max",
+                "Calls/s");
+    w.set_html(page);
+    w.run();
+  } catch (const webview::exception &e) {
+    std::cerr << e.what() << '\n';
+    status = 1;
+  }
+
+  auto app_rss = app_peak_rss_kib();
+  std::printf("Peak RSS: app %ld KiB, web process %ld KiB\n", app_rss,
+              web_rss);
+  if (!opts.json_file.empty() &&
+      !write_json(opts.json_file, results, app_rss, web_rss)) {
+    std::cerr << "Failed to write " << opts.json_file << '\n';
+    status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,161 @@
+// Compares the throughput of loading a large file through a directory mounted
+// on a custom URI scheme with loading the same file through a file:// URL.
+//
+// Usage: webview_scheme_benchmark [size in MiB] [iterations]
+
+#include "webview/webview.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+constexpr const auto html = R"html(<!DOCTYPE html>
+<script>
+  function load(range) {
+    return new Promise((resolve, reject) => {
+      const xhr = new XMLHttpRequest();
+      xhr.responseType = "arraybuffer";
+      xhr.onload = () => resolve(xhr.response.byteLength);
+      xhr.onerror = () => reject(new Error("Failed to load data.bin"));
+      xhr.open("GET", "data.bin");
+      if (range) {
+        xhr.setRequestHeader("Range", range);
+      }
+      xhr.send();
+    });
+  }
+  async function measure(range) {
+    const times = [];
+    for (let i = 0; i < ITERATIONS; ++i) {
+      const start = performance.now();
+      await load(range);
+      times.push(performance.now() - start);
+    }
+    return times;
+  }
+  (async () => {
+    const full = await measure();
+    // The last MiB of the file
+    const tail = await measure("bytes=-1048576");
+    window.report(full, tail);
+  })().catch(e => window.report([], [], e.message));
+</script>)html";
+
+double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  auto middle = values.size() / 2;
+  return values.size() % 2 ? values[middle]
+                           : (values[middle - 1] + values[middle]) / 2;
+}
+
+std::vector<double> parse_times(const std::string &json) {
+  std::vector<double> times;
+  for (int i = 0;; ++i) {
+    auto value = webview::detail::json_parse(json, "", i);
+    if (value.empty()) {
+      break;
+    }
+    // GTK sets the C locale from the environment, which strtod() obeys.
+    times.push_back(webview::detail::json_parse_number(value));
+  }
+  return times;
+}
+
+void print_result(const std::string &label, double size_mib,
+                  const std::vector<double> &times) {
+  auto ms = median(times);
+  std::printf("%-24s median %10.2f ms %12.1f MiB/s\n", label.c_str(), ms,
+              ms > 0 ? size_mib / (ms / 1000) : 0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  auto size_mib = argc > 1 ? std::atoi(argv[1]) : 256;
+  auto iterations = argc > 2 ? std::atoi(argv[2]) : 5;
+  if (size_mib <= 0 || iterations <= 0) {
+    std::cerr << "Usage: " << argv[0] << " [size in MiB] [iterations]\n";
+    return 1;
+  }
+
+  char dir_template[] = "/tmp/webview_scheme_benchmark_XXXXXX";
+  if (!mkdtemp(dir_template)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  std::string dir{dir_template};
+  {
+    std::ofstream data{dir + "/data.bin", std::ios::binary};
+    std::vector<char> chunk(1024 * 1024);
+    for (std::size_t i = 0; i < chunk.size(); ++i) {
+      chunk[i] = static_cast<char>(i * 31);
+    }
+    for (int i = 0; i < size_mib; ++i) {
+      data.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    }
+    auto page = std::string{html};
+    auto placeholder = page.find("ITERATIONS");
+    page.replace(placeholder, 10, std::to_string(iterations));
+    std::ofstream{dir + "/index.html"} << page;
+  }
+
+  int status = 0;
+  try {
+    webview::webview w(false, nullptr);
+    auto res = w.mount_directory("bench", dir);
+    if (!res.ok()) {
+      std::cerr << "Custom URI schemes are not supported by this backend\n";
+    } else {
+#ifdef WEBVIEW_GTK
+      // Allow the file:// page to load the data file.
+      auto *settings = webkit_web_view_get_settings(
+          WEBKIT_WEB_VIEW(w.browser_controller().value()));
+      webkit_settings_set_allow_file_access_from_file_urls(settings, TRUE);
+#endif
+      std::printf("Loading %d MiB, %d iterations\n", size_mib, iterations);
+      bool custom_scheme_done = false;
+      w.bind("report", [&](const std::string &req) -> std::string {
+        auto error = webview::detail::json_parse(req, "", 2);
+        if (!error.empty()) {
+          std::cerr << error << '\n';
+          status = 1;
+          w.terminate();
+          return "";
+        }
+        auto label = custom_scheme_done ? "file://" : "bench://";
+        auto full = parse_times(webview::detail::json_parse(req, "", 0));
+        auto tail = parse_times(webview::detail::json_parse(req, "", 1));
+        print_result(std::string{label} + " full", size_mib, full);
+        print_result(std::string{label} + " last MiB", 1, tail);
+        if (custom_scheme_done) {
+          w.terminate();
+        } else {
+          custom_scheme_done = true;
+          w.navigate("file://" + dir + "/index.html");
+        }
+        return "";
+      });
+      w.navigate("bench://localhost/index.html");
+      w.run();
+    }
+  } catch (const webview::exception &e) {
+    std::cerr << e.what() << '\n';
+    status = 1;
+  }
+
+  std::remove((dir + "/data.bin").c_str());
+  std::remove((dir + "/index.html").c_str());
+  rmdir(dir.c_str());
+  return status;
+}
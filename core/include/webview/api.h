@@ -30,6 +30,8 @@
 #include "macros.h"
 #include "types.h"
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -81,6 +83,63 @@ WEBVIEW_API webview_error_t webview_run(webview_t w);
  */
 WEBVIEW_API webview_error_t webview_terminate(webview_t w);
 
+/**
+ * Runs a single iteration of the main loop. This allows running the webview
+ * from an existing loop instead of using webview_run().
+ *
+ * @param w The webview instance.
+ * @param timeout_ms The maximum number of milliseconds to wait for events.
+ *        Zero does not wait and a negative value waits indefinitely.
+ * @retval WEBVIEW_ERROR_CANCELED The main loop was stopped with
+ *         webview_terminate().
+ * @retval WEBVIEW_ERROR_NOT_SUPPORTED The backend does not support stepping
+ *         the main loop.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_step(webview_t w, int timeout_ms);
+
+/**
+ * Prepares an iteration of the main loop to be polled by an external reactor
+ * e.g. one built on @c epoll or libuv.
+ *
+ * Once the file descriptors have been polled, with the timeout returned in
+ * @p timeout_ms, the iteration is completed with webview_poll_dispatch().
+ * Both functions must be called on the main/GUI thread.
+ *
+ * @param w The webview instance.
+ * @param fds An array that receives the file descriptors to poll.
+ * @param count The capacity of @p fds on input and the number of file
+ *        descriptors to poll on output.
+ * @param timeout_ms Receives the maximum number of milliseconds to wait, or
+ *        -1 to wait indefinitely.
+ * @retval WEBVIEW_ERROR_INVALID_ARGUMENT @p fds is too small to hold all file
+ *         descriptors. The iteration remains prepared and this function can be
+ *         called again with an array of at least @p count elements.
+ * @retval WEBVIEW_ERROR_NOT_SUPPORTED The backend does not support external
+ *         polling.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_poll_prepare(webview_t w,
+                                                 webview_poll_fd_t *fds,
+                                                 size_t *count,
+                                                 int *timeout_ms);
+
+/**
+ * Completes an iteration of the main loop prepared with
+ * webview_poll_prepare().
+ *
+ * @param w The webview instance.
+ * @param fds The file descriptors returned by webview_poll_prepare() with
+ *        @c revents set to the events that occurred.
+ * @param count The number of file descriptors in @p fds.
+ * @retval WEBVIEW_ERROR_CANCELED The main loop was stopped with
+ *         webview_terminate().
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_poll_dispatch(webview_t w,
+                                                  const webview_poll_fd_t *fds,
+                                                  size_t count);
+
 /**
  * Schedules a function to be invoked on the thread with the run/event loop.
  *
@@ -96,6 +155,210 @@ WEBVIEW_API webview_error_t webview_dispatch(webview_t w,
                                              void (*fn)(webview_t w, void *arg),
                                              void *arg);
 
+/**
+ * Enables or disables recording of metrics for binding calls, e.g. call
+ * counts and latencies. Recording is disabled by default.
+ *
+ * @param w The webview instance.
+ * @param enabled Whether to record metrics.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_set_metrics_enabled(webview_t w,
+                                                        int enabled);
+
+/**
+ * Gets metrics and statistics of the webview as a JSON object.
+ *
+ * The object has a @c bindings object with the metrics of each binding
+ * recorded while enabled with webview_set_metrics_enabled(), a @c dispatch
+ * object with statistics of each dispatch priority class, a @c stalls object
+ * with the stalls reported by webview_set_stall_watchdog(), and a @c loop
+ * object with the event loop statistics recorded while enabled with
+ * webview_set_loop_monitoring_enabled().
+ *
+ * @param w The webview instance.
+ * @param json A buffer that receives the null-terminated JSON.
+ * @param size The size of @p json on input, and the size needed for the JSON
+ *        including the null terminator on output.
+ * @retval WEBVIEW_ERROR_INVALID_ARGUMENT @p json is too small. @p size is set
+ *         to the size needed.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_get_stats(webview_t w, char *json,
+                                              size_t *size);
+
+/**
+ * Enables or disables measuring the iterations of the event loop, which is
+ * disabled by default.
+ *
+ * While enabled, the time each iteration spends dispatching, the share of
+ * that time spent in sources owned by the library such as dispatched
+ * functions and timers, and the number of pending dispatched functions are
+ * included in webview_get_stats().
+ *
+ * @param w The webview instance.
+ * @param enabled Whether to measure iterations.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_set_loop_monitoring_enabled(webview_t w,
+                                                                int enabled);
+
+/**
+ * Starts a watchdog thread that reports dispatched functions, binding
+ * handlers and other work that blocks the main/GUI thread for at least a
+ * threshold. Stall counts are included in webview_get_stats().
+ *
+ * The callback is invoked on the watchdog thread with the site of the stall,
+ * e.g. the name of a binding, and how long it has lasted: once when the stall
+ * is noticed while still ongoing, and once with @p finished set to @c 1 when
+ * it has ended. The callback must not call this function.
+ *
+ * @param w The webview instance.
+ * @param threshold_ms The threshold in milliseconds, or @c 0 to stop the
+ *        watchdog.
+ * @param fn The callback function, or @c NULL.
+ * @param arg An optional argument passed along to the callback function.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_set_stall_watchdog(
+    webview_t w, unsigned int threshold_ms,
+    void (*fn)(webview_t w, const char *site, unsigned int duration_ms,
+               int finished, void *arg),
+    void *arg);
+
+/**
+ * Enables or disables tracing of binding calls and dispatched work.
+ *
+ * The tracer is shared by all webview instances in the process. Events are
+ * kept in a fixed-size buffer per thread, overwriting the oldest events.
+ *
+ * @param w The webview instance.
+ * @param enabled Whether to record events.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_set_tracing_enabled(webview_t w,
+                                                        int enabled);
+
+/**
+ * Gets the events recorded by the tracer as JSON in the Chrome trace event
+ * format, which can be loaded into Perfetto or chrome://tracing.
+ *
+ * @param w The webview instance.
+ * @param json A buffer that receives the null-terminated JSON.
+ * @param size The size of @p json on input, and the size needed for the JSON
+ *        including the null terminator on output.
+ * @retval WEBVIEW_ERROR_INVALID_ARGUMENT @p json is too small. @p size is set
+ *         to the size needed.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_get_trace(webview_t w, char *json,
+                                              size_t *size);
+
+/**
+ * Schedules a function to be invoked on the thread with the run/event loop in
+ * a priority class. Functions in higher priority classes are invoked before
+ * functions in lower priority classes that were scheduled earlier.
+ *
+ * Only the GTK backend maps the priority classes to priorities of its main
+ * loop. The Cocoa and Win32 backends ignore the priority when scheduling:
+ * functions are invoked in the order in which the classes were scheduled
+ * with the loop, and only the one-at-a-time pacing of
+ * @c WEBVIEW_DISPATCH_PRIORITY_BACKGROUND still applies.
+ *
+ * @param w The webview instance.
+ * @param fn The function to be invoked.
+ * @param arg An optional argument passed along to the callback function.
+ * @param priority The priority class.
+ * @param deadline_ms The number of milliseconds from now after which the
+ *        function is dropped without being invoked if it has not yet run, or
+ *        0 for no deadline.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_dispatch_with_priority(
+    webview_t w, void (*fn)(webview_t w, void *arg), void *arg,
+    webview_dispatch_priority_t priority, unsigned int deadline_ms);
+
+/**
+ * Schedules a function to be invoked once on the main/GUI thread after a
+ * delay.
+ *
+ * Timers are coalesced with other timers that expire around the same time in
+ * order to reduce the number of wake-ups, which may delay them slightly.
+ *
+ * @param w The webview instance.
+ * @param delay_ms The delay in milliseconds.
+ * @param fn The function to be invoked.
+ * @param arg An optional argument passed along to the callback function.
+ * @param id Receives an ID that can be passed to webview_remove_source(),
+ *        or @c NULL.
+ * @retval WEBVIEW_ERROR_NOT_SUPPORTED The backend does not support timers.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_set_timeout(webview_t w,
+                                                unsigned int delay_ms,
+                                                void (*fn)(webview_t w,
+                                                           void *arg),
+                                                void *arg, unsigned int *id);
+
+/**
+ * Schedules a function to be invoked repeatedly on the main/GUI thread at an
+ * interval until it is removed with webview_remove_source().
+ *
+ * @param w The webview instance.
+ * @param interval_ms The interval in milliseconds. Must not be zero.
+ * @param fn The function to be invoked.
+ * @param arg An optional argument passed along to the callback function.
+ * @param id Receives an ID that can be passed to webview_remove_source(),
+ *        or @c NULL.
+ * @retval WEBVIEW_ERROR_NOT_SUPPORTED The backend does not support timers.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_set_interval(webview_t w,
+                                                 unsigned int interval_ms,
+                                                 void (*fn)(webview_t w,
+                                                            void *arg),
+                                                 void *arg, unsigned int *id);
+
+/**
+ * Watches a file descriptor from the main loop and invokes a function on the
+ * main/GUI thread whenever it is ready for one of the given events, until the
+ * watch is removed with webview_remove_source().
+ *
+ * The watch is removed automatically after the function has been invoked
+ * with @c POLLHUP, @c POLLERR or @c POLLNVAL, since these events are reported
+ * until the file descriptor is closed. Data that is still readable should be
+ * read during that invocation.
+ *
+ * @param w The webview instance.
+ * @param fd The file descriptor.
+ * @param events The events to watch for, using the same flags as @c poll()
+ *        e.g. @c POLLIN.
+ * @param fn The function to be invoked with the events that occurred.
+ * @param arg An optional argument passed along to the callback function.
+ * @param id Receives an ID that can be passed to webview_remove_source(),
+ *        or @c NULL.
+ * @retval WEBVIEW_ERROR_NOT_SUPPORTED The backend does not support watching
+ *         file descriptors.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_watch_fd(
+    webview_t w, int fd, unsigned short events,
+    void (*fn)(webview_t w, int fd, unsigned short revents, void *arg),
+    void *arg, unsigned int *id);
+
+/**
+ * Removes a timer or file descriptor watch. Timers created with
+ * webview_set_timeout() are removed automatically after they have been
+ * invoked.
+ *
+ * @param w The webview instance.
+ * @param id The ID of the timer or watch.
+ * @retval WEBVIEW_ERROR_NOT_FOUND No timer or watch with the given ID exists.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_remove_source(webview_t w,
+                                                  unsigned int id);
+
 /**
  * Returns the native handle of the window associated with the webview instance.
  * The handle can be a @c GtkWindow pointer (GTK), @c NSWindow pointer (Cocoa)
@@ -173,6 +436,25 @@ WEBVIEW_API webview_error_t webview_navigate(webview_t w, const char *url);
  */
 WEBVIEW_API webview_error_t webview_set_html(webview_t w, const char *html);
 
+/**
+ * Load HTML content into the webview without copying it, if supported by the
+ * backend.
+ *
+ * The webview takes ownership of the memory, which must remain valid and
+ * unchanged until @p free_fn is called. @p free_fn is called exactly once,
+ * also if the function fails.
+ *
+ * @param w The webview instance.
+ * @param html HTML content. Does not need to be null-terminated.
+ * @param size The size of the HTML content in bytes.
+ * @param free_fn A function that releases the HTML content, or @c NULL.
+ * @param arg User-defined argument passed to @p free_fn.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_set_html_buffer(
+    webview_t w, const char *html, size_t size,
+    void (*free_fn)(const char *html, void *arg), void *arg);
+
 /**
  * Injects JavaScript code to be executed immediately upon loading a page.
  * The code will be executed before @c window.onload.
@@ -192,6 +474,31 @@ WEBVIEW_API webview_error_t webview_init(webview_t w, const char *js);
  */
 WEBVIEW_API webview_error_t webview_eval(webview_t w, const char *js);
 
+/**
+ * Evaluates arbitrary JavaScript code and passes the result to a callback
+ * function.
+ *
+ * The callback function is invoked on the main/GUI thread with a status, the
+ * result and a user-provided argument. A status of zero means that the
+ * evaluation succeeded and the result is the JSON-serialized value of the
+ * script, or an empty string if the value can't be serialized, e.g.
+ * @c undefined. Any other status means that an exception was thrown, in which
+ * case the result is the error message as a JSON string.
+ *
+ * @param w The webview instance.
+ * @param js JS content.
+ * @param fn Callback function.
+ * @param arg User argument.
+ * @retval WEBVIEW_ERROR_INVALID_STATE No content has begun loading yet.
+ * @retval WEBVIEW_ERROR_NOT_SUPPORTED
+ *         The backend doesn't support retrieving the result of a script.
+ * @since 0.13
+ */
+WEBVIEW_API webview_error_t webview_eval_async(
+    webview_t w, const char *js,
+    void (*fn)(webview_t w, int status, const char *result, void *arg),
+    void *arg);
+
 /**
  * Binds a function pointer to a new global JavaScript function.
  *
@@ -28,9 +28,14 @@
 
 #if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
 
+#ifdef WEBVIEW_NULL
+#include "detail/backends/null_engine.hh"
+#else
 #include "detail/backends/cocoa_webkit.hh"
 #include "detail/backends/gtk_webkitgtk.hh"
+#include "detail/backends/null_engine.hh"
 #include "detail/backends/win32_edge.hh"
+#endif
 
 namespace webview {
 using webview = browser_engine;
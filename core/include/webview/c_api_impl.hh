@@ -36,6 +36,9 @@
 #include "types.h"
 #include "version.h"
 
+#include <chrono>
+#include <cstring>
+
 namespace webview {
 namespace detail {
 
@@ -120,6 +123,51 @@ WEBVIEW_API webview_error_t webview_terminate(webview_t w) {
   return api_filter([=] { return cast_to_webview(w)->terminate(); });
 }
 
+WEBVIEW_API webview_error_t webview_step(webview_t w, int timeout_ms) {
+  using namespace webview::detail;
+  return api_filter([=] { return cast_to_webview(w)->step(timeout_ms); });
+}
+
+WEBVIEW_API webview_error_t webview_poll_prepare(webview_t w,
+                                                 webview_poll_fd_t *fds,
+                                                 size_t *count,
+                                                 int *timeout_ms) {
+  using namespace webview::detail;
+  if (!count || (!fds && *count > 0) || !timeout_ms) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter([=]() -> webview::noresult {
+    std::vector<webview_poll_fd_t> prepared;
+    auto res = cast_to_webview(w)->poll_prepare(prepared);
+    if (!res.ok()) {
+      return webview::error_info{res.error()};
+    }
+    auto capacity = *count;
+    *count = prepared.size();
+    *timeout_ms = res.value();
+    if (prepared.size() > capacity) {
+      return webview::error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    for (size_t i = 0; i < prepared.size(); ++i) {
+      fds[i] = prepared[i];
+    }
+    return {};
+  });
+}
+
+WEBVIEW_API webview_error_t webview_poll_dispatch(webview_t w,
+                                                  const webview_poll_fd_t *fds,
+                                                  size_t count) {
+  using namespace webview::detail;
+  if (!fds && count > 0) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter([=] {
+    return cast_to_webview(w)->poll_dispatch(
+        std::vector<webview_poll_fd_t>(fds, fds + count));
+  });
+}
+
 WEBVIEW_API webview_error_t webview_dispatch(webview_t w,
                                              void (*fn)(webview_t, void *),
                                              void *arg) {
@@ -131,6 +179,175 @@ WEBVIEW_API webview_error_t webview_dispatch(webview_t w,
       [=] { return cast_to_webview(w)->dispatch([=]() { fn(w, arg); }); });
 }
 
+WEBVIEW_API webview_error_t webview_set_metrics_enabled(webview_t w,
+                                                        int enabled) {
+  using namespace webview::detail;
+  return api_filter([=]() -> webview::noresult {
+    cast_to_webview(w)->set_metrics_enabled(enabled != 0);
+    return {};
+  });
+}
+
+WEBVIEW_API webview_error_t webview_get_stats(webview_t w, char *json,
+                                              size_t *size) {
+  using namespace webview::detail;
+  if (!size || (!json && *size > 0)) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter([=]() -> webview::noresult {
+    auto stats = cast_to_webview(w)->get_stats_json();
+    auto capacity = *size;
+    *size = stats.size() + 1;
+    if (capacity < *size) {
+      return webview::error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    std::memcpy(json, stats.c_str(), *size);
+    return {};
+  });
+}
+
+WEBVIEW_API webview_error_t webview_set_loop_monitoring_enabled(webview_t w,
+                                                                int enabled) {
+  using namespace webview::detail;
+  return api_filter([=]() -> webview::noresult {
+    cast_to_webview(w)->set_loop_monitoring_enabled(enabled != 0);
+    return {};
+  });
+}
+
+WEBVIEW_API webview_error_t webview_set_stall_watchdog(
+    webview_t w, unsigned int threshold_ms,
+    void (*fn)(webview_t w, const char *site, unsigned int duration_ms,
+               int finished, void *arg),
+    void *arg) {
+  using namespace webview::detail;
+  return api_filter([=] {
+    stall_watchdog::callback_t callback;
+    if (fn) {
+      callback = [=](const std::string &site,
+                     std::chrono::milliseconds duration, bool finished) {
+        fn(w, site.c_str(), static_cast<unsigned int>(duration.count()),
+           finished ? 1 : 0, arg);
+      };
+    }
+    return cast_to_webview(w)->set_stall_watchdog(
+        std::chrono::milliseconds{threshold_ms}, std::move(callback));
+  });
+}
+
+WEBVIEW_API webview_error_t webview_set_tracing_enabled(webview_t w,
+                                                        int enabled) {
+  using namespace webview::detail;
+  return api_filter([=]() -> webview::noresult {
+    cast_to_webview(w)->set_tracing_enabled(enabled != 0);
+    return {};
+  });
+}
+
+WEBVIEW_API webview_error_t webview_get_trace(webview_t w, char *json,
+                                              size_t *size) {
+  using namespace webview::detail;
+  if (!size || (!json && *size > 0)) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter([=]() -> webview::noresult {
+    auto trace = cast_to_webview(w)->get_trace_json();
+    auto capacity = *size;
+    *size = trace.size() + 1;
+    if (capacity < *size) {
+      return webview::error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    std::memcpy(json, trace.c_str(), *size);
+    return {};
+  });
+}
+
+WEBVIEW_API webview_error_t webview_dispatch_with_priority(
+    webview_t w, void (*fn)(webview_t w, void *arg), void *arg,
+    webview_dispatch_priority_t priority, unsigned int deadline_ms) {
+  using namespace webview::detail;
+  if (!fn) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  auto deadline = dispatch_queues::clock::time_point::max();
+  if (deadline_ms > 0) {
+    deadline = dispatch_queues::clock::now() +
+               std::chrono::milliseconds{deadline_ms};
+  }
+  return api_filter([=] {
+    return cast_to_webview(w)->dispatch([=]() { fn(w, arg); }, priority,
+                                        deadline);
+  });
+}
+
+WEBVIEW_API webview_error_t webview_set_timeout(webview_t w,
+                                                unsigned int delay_ms,
+                                                void (*fn)(webview_t w,
+                                                           void *arg),
+                                                void *arg, unsigned int *id) {
+  using namespace webview::detail;
+  if (!fn) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter(
+      [=] {
+        return cast_to_webview(w)->set_timeout([=] { fn(w, arg); }, delay_ms);
+      },
+      [=](unsigned int id_) {
+        if (id) {
+          *id = id_;
+        }
+      });
+}
+
+WEBVIEW_API webview_error_t webview_set_interval(webview_t w,
+                                                 unsigned int interval_ms,
+                                                 void (*fn)(webview_t w,
+                                                            void *arg),
+                                                 void *arg, unsigned int *id) {
+  using namespace webview::detail;
+  if (!fn) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter(
+      [=] {
+        return cast_to_webview(w)->set_interval([=] { fn(w, arg); },
+                                                interval_ms);
+      },
+      [=](unsigned int id_) {
+        if (id) {
+          *id = id_;
+        }
+      });
+}
+
+WEBVIEW_API webview_error_t webview_watch_fd(
+    webview_t w, int fd, unsigned short events,
+    void (*fn)(webview_t w, int fd, unsigned short revents, void *arg),
+    void *arg, unsigned int *id) {
+  using namespace webview::detail;
+  if (!fn) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter(
+      [=] {
+        return cast_to_webview(w)->watch_fd(
+            fd, events,
+            [=](unsigned short revents) { fn(w, fd, revents, arg); });
+      },
+      [=](unsigned int id_) {
+        if (id) {
+          *id = id_;
+        }
+      });
+}
+
+WEBVIEW_API webview_error_t webview_remove_source(webview_t w,
+                                                  unsigned int id) {
+  using namespace webview::detail;
+  return api_filter([=] { return cast_to_webview(w)->remove_source(id); });
+}
+
 WEBVIEW_API void *webview_get_window(webview_t w) {
   using namespace webview::detail;
   void *window = nullptr;
@@ -198,6 +415,24 @@ WEBVIEW_API webview_error_t webview_set_html(webview_t w, const char *html) {
   return api_filter([=] { return cast_to_webview(w)->set_html(html); });
 }
 
+WEBVIEW_API webview_error_t webview_set_html_buffer(
+    webview_t w, const char *html, size_t size,
+    void (*free_fn)(const char *html, void *arg), void *arg) {
+  using namespace webview::detail;
+  // Take ownership first so that the memory is released also on failure.
+  std::shared_ptr<const void> owner;
+  if (free_fn) {
+    owner = std::shared_ptr<const void>{
+        html, [=](const void *) { free_fn(html, arg); }};
+  }
+  if (!html && size > 0) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter([=] {
+    return cast_to_webview(w)->set_html(buffer{html, size, owner});
+  });
+}
+
 WEBVIEW_API webview_error_t webview_init(webview_t w, const char *js) {
   using namespace webview::detail;
   if (!js) {
@@ -214,6 +449,22 @@ WEBVIEW_API webview_error_t webview_eval(webview_t w, const char *js) {
   return api_filter([=] { return cast_to_webview(w)->eval(js); });
 }
 
+WEBVIEW_API webview_error_t webview_eval_async(
+    webview_t w, const char *js,
+    void (*fn)(webview_t w, int status, const char *result, void *arg),
+    void *arg) {
+  using namespace webview::detail;
+  if (!js || !fn) {
+    return WEBVIEW_ERROR_INVALID_ARGUMENT;
+  }
+  return api_filter([=] {
+    return cast_to_webview(w)->eval_async(
+        js, [=](int status, const std::string &result) {
+          fn(w, status, result.c_str(), arg);
+        });
+  });
+}
+
 WEBVIEW_API webview_error_t webview_bind(webview_t w, const char *name,
                                          void (*fn)(const char *id,
                                                     const char *req, void *arg),
@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_ASSET_BUNDLE_HH
+#define WEBVIEW_DETAIL_ASSET_BUNDLE_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "../errors.hh"
+#include "../types.hh"
+#include "buffer.hh"
+#include "mapped_file.hh"
+#include "scheme.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace webview {
+namespace detail {
+
+// A read-only collection of web assets created by webview_add_asset_bundle()
+// in CMake. Entries refer to the memory of the bundle without copying.
+//
+// The bundle starts with a 16-byte header (magic "WVAB", version, number of
+// entries, reserved) followed by an index of 48-byte entries sorted by path.
+// Each entry holds the offset and size of the path, the MIME type and the
+// content, a 64-bit hash of the uncompressed content and flags. All integers
+// are little-endian and offsets are relative to the start of the bundle.
+class asset_bundle {
+public:
+  struct entry {
+    std::string path;
+    std::string mime_type;
+    // Content encoding of the data, e.g. "gzip", or empty if uncompressed.
+    std::string encoding;
+    std::string etag;
+    buffer data;
+  };
+
+  asset_bundle() = default;
+
+  // Uses a bundle that has been linked into the program.
+  static result<asset_bundle> from_memory(const void *data, std::size_t size) {
+    return from_buffer(buffer{data, size, nullptr});
+  }
+
+  // Maps a bundle file into memory.
+  static result<asset_bundle> open(const std::string &path) {
+    auto mapped = map_file(path);
+    if (!mapped.ok()) {
+      return mapped.error();
+    }
+    return from_buffer(mapped.value());
+  }
+
+  static result<asset_bundle> from_buffer(buffer data) {
+    if (data.size() < header_size ||
+        std::memcmp(data.data(), "WVAB", 4) != 0) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT, "Not an asset bundle"};
+    }
+    if (read_u32(data.data() + 4) != 1) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT,
+                        "Unsupported asset bundle version"};
+    }
+    auto count = read_u32(data.data() + 8);
+    if ((data.size() - header_size) / index_entry_size < count) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT, "Truncated bundle"};
+    }
+    asset_bundle bundle;
+    bundle.m_entries.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+      const auto *p = data.data() + header_size + i * index_entry_size;
+      entry e;
+      if (!read_string(data, read_u32(p), read_u32(p + 4), e.path) ||
+          !read_string(data, read_u32(p + 8), read_u32(p + 12), e.mime_type) ||
+          !in_range(data, read_u64(p + 16), read_u64(p + 24))) {
+        return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT, "Corrupt bundle"};
+      }
+      e.data = data.slice(static_cast<std::size_t>(read_u64(p + 16)),
+                          static_cast<std::size_t>(read_u64(p + 24)));
+      char etag[20];
+      std::snprintf(etag, sizeof(etag), "\"%016llx\"",
+                    static_cast<unsigned long long>(read_u64(p + 32)));
+      e.etag = etag;
+      if (read_u32(p + 40) & flag_gzip) {
+        e.encoding = "gzip";
+      }
+      const auto &entries = bundle.m_entries;
+      if (!entries.empty() && !(entries.back().path < e.path)) {
+        return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT, "Unsorted bundle"};
+      }
+      bundle.m_entries.emplace_back(std::move(e));
+    }
+    return bundle;
+  }
+
+  // Finds an entry by its path relative to the bundled directory, e.g.
+  // "index.html" or "js/app.js".
+  const entry *find(const std::string &path) const {
+    std::size_t first = 0;
+    std::size_t last = m_entries.size();
+    while (first < last) {
+      auto middle = first + (last - first) / 2;
+      auto cmp = m_entries[middle].path.compare(path);
+      if (cmp == 0) {
+        return &m_entries[middle];
+      }
+      if (cmp < 0) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    return nullptr;
+  }
+
+  const std::vector<entry> &entries() const { return m_entries; }
+
+  // Serves an entry for a request on a custom URI scheme. The request path
+  // is percent-decoded and directories are served by their index.html file.
+  scheme_response serve(const scheme_request &request) const {
+    std::string path;
+    if (!percent_decode(request.path, path)) {
+      scheme_response response;
+      response.status = 400;
+      return response;
+    }
+    if (!path.empty() && path[0] == '/') {
+      path.erase(0, 1);
+    }
+    if (path.empty() || path.back() == '/') {
+      path += "index.html";
+    }
+    const auto *found = find(path);
+    if (!found) {
+      scheme_response response;
+      response.status = 404;
+      return response;
+    }
+    return make_resource_response(request, found->data, found->mime_type,
+                                  found->encoding, found->etag);
+  }
+
+private:
+  static const std::size_t header_size = 16;
+  static const std::size_t index_entry_size = 48;
+  static const std::uint32_t flag_gzip = 1;
+
+  static std::uint32_t read_u32(const unsigned char *p) {
+    return static_cast<std::uint32_t>(p[0]) |
+           static_cast<std::uint32_t>(p[1]) << 8 |
+           static_cast<std::uint32_t>(p[2]) << 16 |
+           static_cast<std::uint32_t>(p[3]) << 24;
+  }
+
+  static std::uint64_t read_u64(const unsigned char *p) {
+    return static_cast<std::uint64_t>(read_u32(p)) |
+           static_cast<std::uint64_t>(read_u32(p + 4)) << 32;
+  }
+
+  static bool in_range(const buffer &data, std::uint64_t offset,
+                       std::uint64_t size) {
+    return offset <= data.size() && size <= data.size() - offset;
+  }
+
+  static bool read_string(const buffer &data, std::uint64_t offset,
+                          std::uint64_t size, std::string &out) {
+    if (!in_range(data, offset, size)) {
+      return false;
+    }
+    out.assign(reinterpret_cast<const char *>(data.data()) + offset,
+               static_cast<std::size_t>(size));
+    return true;
+  }
+
+  std::vector<entry> m_entries;
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_ASSET_BUNDLE_HH
@@ -101,6 +101,7 @@ public:
   cocoa_wkwebview_engine &operator=(cocoa_wkwebview_engine &&) = delete;
 
   virtual ~cocoa_wkwebview_engine() {
+    stop_stall_watchdog();
     objc::autoreleasepool arp;
     if (m_window) {
       if (m_webview) {
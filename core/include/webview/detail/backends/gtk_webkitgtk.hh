@@ -47,7 +47,12 @@
 
 #include "../../errors.hh"
 #include "../../types.hh"
+#include "../buffer.hh"
 #include "../engine_base.hh"
+#include "../scheme.hh"
+#include "../tracer.hh"
+#include "../platform/linux/gio/generator_input_stream.hh"
+#include "../platform/linux/glib/timer_source.hh"
 #include "../platform/linux/gtk/compat.hh"
 #include "../platform/linux/webkitgtk/compat.hh"
 #include "../platform/linux/webkitgtk/dmabuf.hh"
@@ -55,8 +60,12 @@
 
 #include <functional>
 #include <list>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gtk/gtk.h>
 
@@ -73,6 +82,7 @@
 #endif
 
 #include <fcntl.h>
+#include <glib-unix.h>
 #include <sys/stat.h>
 
 namespace webview {
@@ -99,7 +109,11 @@ private:
 
 class gtk_webkit_engine : public engine_base {
 public:
-  gtk_webkit_engine(bool debug, void *window) : engine_base{!window} {
+  // The engine always runs on the global default main context, which GTK and
+  // WebKitGTK attach their sources to, even if another context has been
+  // pushed as the thread-default context.
+  gtk_webkit_engine(bool debug, void *window)
+      : engine_base{!window}, m_context{g_main_context_ref(g_main_context_default())} {
     window_init(window);
     window_settings(debug);
     dispatch_size_default();
@@ -111,6 +125,7 @@ public:
   gtk_webkit_engine &operator=(gtk_webkit_engine &&) = delete;
 
   virtual ~gtk_webkit_engine() {
+    stop_stall_watchdog();
     if (m_window) {
       if (owns_window()) {
         // Disconnect handlers to avoid callbacks invoked during destruction.
@@ -122,13 +137,20 @@ public:
                                         GTK_WIDGET(m_webview));
       }
     }
+    for (const auto &source : m_sources) {
+      g_source_destroy(source.second);
+      g_source_unref(source.second);
+    }
+    m_sources.clear();
     if (m_webview) {
+      g_object_set_data(G_OBJECT(m_webview), "webview-engine", nullptr);
       g_object_unref(m_webview);
     }
     if (owns_window()) {
       // Needed for the window to close immediately.
       deplete_run_loop_event_queue();
     }
+    g_main_context_unref(m_context);
   }
 
 protected:
@@ -156,7 +178,7 @@ protected:
   noresult run_impl() override {
     m_stop_run_loop = false;
     while (!m_stop_run_loop) {
-      g_main_context_iteration(nullptr, TRUE);
+      iterate(true);
     }
     return {};
   }
@@ -165,13 +187,136 @@ protected:
     return dispatch_impl([&] { m_stop_run_loop = true; });
   }
 
+  noresult step_impl(int timeout_ms) override {
+    if (timeout_ms > 0) {
+      // Wakes up the iteration below if nothing else happens in time.
+      auto *source = g_timeout_source_new(static_cast<guint>(timeout_ms));
+      g_source_set_callback(
+          source, +[](gpointer) -> gboolean { return G_SOURCE_REMOVE; },
+          nullptr, nullptr);
+      g_source_attach(source, m_context);
+      iterate(true);
+      g_source_destroy(source);
+      g_source_unref(source);
+    } else {
+      iterate(timeout_ms < 0);
+    }
+    return take_stop_request();
+  }
+
+  result<int>
+  poll_prepare_impl(std::vector<webview_poll_fd_t> &fds) override {
+    if (!m_poll_prepared) {
+      if (!g_main_context_acquire(m_context)) {
+        return error_info{WEBVIEW_ERROR_INVALID_STATE,
+                          "The main context is owned by another thread"};
+      }
+      g_main_context_prepare(m_context, &m_poll_max_priority);
+      m_poll_prepared = true;
+    }
+    gint timeout{};
+    auto count = g_main_context_query(
+        m_context, m_poll_max_priority, &timeout, m_poll_fds.data(),
+        static_cast<gint>(m_poll_fds.size()));
+    if (static_cast<std::size_t>(count) > m_poll_fds.size()) {
+      m_poll_fds.resize(static_cast<std::size_t>(count));
+      count = g_main_context_query(m_context, m_poll_max_priority, &timeout,
+                                   m_poll_fds.data(), count);
+    }
+    m_poll_fds.resize(static_cast<std::size_t>(count));
+    fds.resize(m_poll_fds.size());
+    for (std::size_t i = 0; i < fds.size(); ++i) {
+      fds[i].fd = m_poll_fds[i].fd;
+      fds[i].events = m_poll_fds[i].events;
+      fds[i].revents = 0;
+    }
+    return timeout;
+  }
+
+  noresult
+  poll_dispatch_impl(const std::vector<webview_poll_fd_t> &fds) override {
+    if (!m_poll_prepared) {
+      return error_info{WEBVIEW_ERROR_INVALID_STATE,
+                        "poll_prepare() must be called first"};
+    }
+    if (fds.size() != m_poll_fds.size()) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    for (std::size_t i = 0; i < fds.size(); ++i) {
+      m_poll_fds[i].revents = fds[i].revents;
+    }
+    m_poll_prepared = false;
+    check_and_dispatch(m_poll_max_priority, m_poll_fds);
+    g_main_context_release(m_context);
+    return take_stop_request();
+  }
+
   noresult dispatch_impl(std::function<void()> f) override {
-    g_idle_add_full(G_PRIORITY_HIGH_IDLE, (GSourceFunc)([](void *fn) -> int {
-                      (*static_cast<dispatch_fn_t *>(fn))();
-                      return G_SOURCE_REMOVE;
-                    }),
-                    new std::function<void()>(f),
-                    [](void *fn) { delete static_cast<dispatch_fn_t *>(fn); });
+    return add_idle(std::move(f), G_PRIORITY_HIGH_IDLE);
+  }
+
+  noresult schedule_impl(std::function<void()> f,
+                         webview_dispatch_priority_t priority) override {
+    switch (priority) {
+    case WEBVIEW_DISPATCH_PRIORITY_URGENT:
+      // Ahead of input events and redrawing.
+      return add_idle(std::move(f), G_PRIORITY_HIGH);
+    case WEBVIEW_DISPATCH_PRIORITY_BACKGROUND:
+      // Behind redrawing and anything else at the default priorities.
+      return add_idle(std::move(f), G_PRIORITY_DEFAULT_IDLE);
+    default:
+      return add_idle(std::move(f), G_PRIORITY_HIGH_IDLE);
+    }
+  }
+
+  result<unsigned int> add_timer_impl(std::function<void()> fn,
+                                      unsigned int interval_ms,
+                                      bool repeat) override {
+    auto id = ++m_last_source_id;
+    if (!repeat) {
+      // One-shot timers forget about themselves once they have been called.
+      fn = [this, id, fn] {
+        fn();
+        release_source(id);
+      };
+    }
+    return add_source(id, timer_source::create(interval_ms, repeat, fn));
+  }
+
+  result<unsigned int>
+  watch_fd_impl(int fd, unsigned short events, fd_watch_fn_t fn) override {
+    auto id = ++m_last_source_id;
+    auto *source = g_unix_fd_source_new(fd, static_cast<GIOCondition>(events));
+    // GUnixFDSourceFunc must be cast through a generic function pointer.
+    GUnixFDSourceFunc callback = [](gint, GIOCondition condition,
+                                    gpointer fn) -> gboolean {
+      (*static_cast<fd_watch_fn_t *>(fn))(
+          static_cast<unsigned short>(condition));
+      // These conditions are reported until the file descriptor is closed,
+      // so keeping the watch would spin the loop.
+      return condition & (G_IO_HUP | G_IO_ERR | G_IO_NVAL) ? G_SOURCE_REMOVE
+                                                           : G_SOURCE_CONTINUE;
+    };
+    g_source_set_callback(
+        source,
+        reinterpret_cast<GSourceFunc>(reinterpret_cast<void (*)()>(callback)),
+        new fd_watch_fn_t{[this, id, fn](unsigned short revents) {
+          fn(revents);
+          if (revents & (G_IO_HUP | G_IO_ERR | G_IO_NVAL)) {
+            release_source(id);
+          }
+        }},
+        [](void *fn) { delete static_cast<fd_watch_fn_t *>(fn); });
+    return add_source(id, source);
+  }
+
+  noresult remove_source_impl(unsigned int id) override {
+    auto found = m_sources.find(id);
+    if (found == m_sources.end()) {
+      return error_info{WEBVIEW_ERROR_NOT_FOUND};
+    }
+    g_source_destroy(found->second);
+    release_source(id);
     return {};
   }
 
@@ -205,6 +350,14 @@ protected:
     return {};
   }
 
+  noresult set_html_buffer_impl(buffer html) override {
+    auto *bytes = create_bytes(html);
+    webkit_web_view_load_bytes(WEBKIT_WEB_VIEW(m_webview), bytes, "text/html",
+                               "UTF-8", nullptr);
+    g_bytes_unref(bytes);
+    return {};
+  }
+
   noresult eval_impl(const std::string &js) override {
     // URI is null before content has begun loading.
     if (!webkit_web_view_get_uri(WEBKIT_WEB_VIEW(m_webview))) {
@@ -212,16 +365,180 @@ protected:
     }
 #if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 40) ||               \
     WEBKIT_MAJOR_VERSION > 2
-    webkit_web_view_evaluate_javascript(WEBKIT_WEB_VIEW(m_webview), js.c_str(),
-                                        static_cast<gssize>(js.size()), nullptr,
-                                        nullptr, nullptr, nullptr, nullptr);
+    auto *trace = begin_eval_trace();
+    webkit_web_view_evaluate_javascript(
+        WEBKIT_WEB_VIEW(m_webview), js.c_str(), static_cast<gssize>(js.size()),
+        nullptr, nullptr, nullptr,
+        trace ? +[](GObject *object, GAsyncResult *res, gpointer arg) {
+          GError *error{};
+          auto *value = webkit_web_view_evaluate_javascript_finish(
+              WEBKIT_WEB_VIEW(object), res, &error);
+          if (value) {
+            g_object_unref(value);
+          }
+          end_eval_trace(arg, error);
+        } : nullptr,
+        trace);
 #else
-    webkit_web_view_run_javascript(WEBKIT_WEB_VIEW(m_webview), js.c_str(),
-                                   nullptr, nullptr, nullptr);
+    auto *trace = begin_eval_trace();
+    webkit_web_view_run_javascript(
+        WEBKIT_WEB_VIEW(m_webview), js.c_str(), nullptr,
+        trace ? +[](GObject *object, GAsyncResult *res, gpointer arg) {
+          GError *error{};
+          auto *js_result = webkit_web_view_run_javascript_finish(
+              WEBKIT_WEB_VIEW(object), res, &error);
+          if (js_result) {
+            webkit_javascript_result_unref(js_result);
+          }
+          end_eval_trace(arg, error);
+        } : nullptr,
+        trace);
 #endif
     return {};
   }
 
+  noresult eval_async_impl(const std::string &js,
+                           eval_callback_t callback) override {
+    // URI is null before content has begun loading.
+    if (!webkit_web_view_get_uri(WEBKIT_WEB_VIEW(m_webview))) {
+      return error_info{WEBVIEW_ERROR_INVALID_STATE};
+    }
+#if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 40) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+    webkit_web_view_evaluate_javascript(
+        WEBKIT_WEB_VIEW(m_webview), js.c_str(), static_cast<gssize>(js.size()),
+        nullptr, nullptr, nullptr,
+        +[](GObject *object, GAsyncResult *res, gpointer arg) {
+          std::unique_ptr<eval_callback_t> callback{
+              static_cast<eval_callback_t *>(arg)};
+          GError *error{};
+          auto *value = webkit_web_view_evaluate_javascript_finish(
+              WEBKIT_WEB_VIEW(object), res, &error);
+          complete_eval(*callback, value, error);
+          if (value) {
+            g_object_unref(value);
+          }
+        },
+        new eval_callback_t{std::move(callback)});
+    return {};
+#elif (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 28) ||             \
+    WEBKIT_MAJOR_VERSION > 2
+    webkit_web_view_run_javascript(
+        WEBKIT_WEB_VIEW(m_webview), js.c_str(), nullptr,
+        +[](GObject *object, GAsyncResult *res, gpointer arg) {
+          std::unique_ptr<eval_callback_t> callback{
+              static_cast<eval_callback_t *>(arg)};
+          GError *error{};
+          auto *js_result = webkit_web_view_run_javascript_finish(
+              WEBKIT_WEB_VIEW(object), res, &error);
+          complete_eval(*callback,
+                        js_result
+                            ? webkit_javascript_result_get_js_value(js_result)
+                            : nullptr,
+                        error);
+          if (js_result) {
+            webkit_javascript_result_unref(js_result);
+          }
+        },
+        new eval_callback_t{std::move(callback)});
+    return {};
+#else
+    (void)js;
+    (void)callback;
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+#endif
+  }
+
+#if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 40) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+  noresult call_js_impl(const std::string &function_body,
+                        const js_args_t &args) override {
+    // URI is null before content has begun loading.
+    if (!webkit_web_view_get_uri(WEBKIT_WEB_VIEW(m_webview))) {
+      return {};
+    }
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    for (const auto &arg : args) {
+      auto *value = to_gvariant(arg.second);
+      if (!value) {
+        // Fall back to generating the code when GVariant can't hold the value.
+        g_variant_builder_clear(&builder);
+        return engine_base::call_js_impl(function_body, args);
+      }
+      g_variant_builder_add(&builder, "{sv}", arg.first.c_str(), value);
+    }
+    // The function body stays the same between calls while the arguments
+    // change, so WebKit can cache the compiled code.
+    auto *trace = begin_eval_trace();
+    webkit_web_view_call_async_javascript_function(
+        WEBKIT_WEB_VIEW(m_webview), function_body.c_str(),
+        static_cast<gssize>(function_body.size()),
+        g_variant_builder_end(&builder), nullptr, nullptr, nullptr,
+        trace ? +[](GObject *object, GAsyncResult *res, gpointer arg) {
+          GError *error{};
+          auto *value = webkit_web_view_call_async_javascript_function_finish(
+              WEBKIT_WEB_VIEW(object), res, &error);
+          if (value) {
+            g_object_unref(value);
+          }
+          end_eval_trace(arg, error);
+        } : nullptr,
+        trace);
+    return {};
+  }
+#endif
+
+  // Time at which a script was submitted on behalf of a binding call.
+  struct eval_trace {
+    std::string id;
+    tracer::clock::time_point submitted;
+  };
+
+  // Returns the state needed to trace the completion of a script evaluated on
+  // behalf of a binding call, or null when there is nothing to trace.
+  static eval_trace *begin_eval_trace() {
+    if (!tracer::instance().is_enabled() ||
+        tracer::current_call_id().empty()) {
+      return nullptr;
+    }
+    return new eval_trace{tracer::current_call_id(), tracer::clock::now()};
+  }
+
+  static void end_eval_trace(gpointer arg, GError *error) {
+    std::unique_ptr<eval_trace> trace{static_cast<eval_trace *>(arg)};
+    if (error) {
+      g_error_free(error);
+    }
+    tracer::instance().record("ipc", "eval_complete", trace->submitted,
+                              tracer::clock::now(), trace->id);
+  }
+
+  noresult register_scheme_impl(const std::string &scheme) override {
+    auto *context = webkit_web_view_get_context(WEBKIT_WEB_VIEW(m_webview));
+    // Schemes are registered per web context, which may be shared by several
+    // web views, so requests are forwarded to the engine of the web view.
+    static std::set<std::pair<WebKitWebContext *, std::string>> registered;
+    if (!registered.emplace(context, scheme).second) {
+      return {};
+    }
+    auto callback = +[](WebKitURISchemeRequest *request, gpointer) {
+      if (auto *engine = get_engine(request)) {
+        engine->on_uri_scheme_request(request);
+        return;
+      }
+      finish_uri_scheme_request_without_handler(request);
+    };
+    webkit_web_context_register_uri_scheme(context, scheme.c_str(), callback,
+                                           nullptr, nullptr);
+    auto *security_manager = webkit_web_context_get_security_manager(context);
+    webkit_security_manager_register_uri_scheme_as_secure(security_manager,
+                                                          scheme.c_str());
+    webkit_security_manager_register_uri_scheme_as_cors_enabled(
+        security_manager, scheme.c_str());
+    return {};
+  }
+
   user_script add_user_script_impl(const std::string &js) override {
     auto *wk_script = webkit_user_script_new(
         js.c_str(), WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
@@ -271,6 +588,321 @@ private:
   }
 #endif
 
+#if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 28) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+  // Passes the result of a script evaluation to the callback and frees the
+  // error if there is one.
+  static void complete_eval(const eval_callback_t &callback, JSCValue *value,
+                            GError *error) {
+    if (error) {
+      std::string message{error->message ? error->message : ""};
+      g_error_free(error);
+      callback(1, json_escape(message));
+      return;
+    }
+    std::string result;
+    // Serialization fails for e.g. undefined and functions.
+    if (auto *json = value ? jsc_value_to_json(value, 0) : nullptr) {
+      result = json;
+      g_free(json);
+    }
+    callback(0, result);
+  }
+#endif
+
+  // Returns a new floating GVariant reference or null if the value can't be
+  // represented.
+  static GVariant *to_gvariant(const js_arg &arg) {
+    switch (arg.get_kind()) {
+    case js_arg::kind::string: {
+      const auto &value = arg.get_string();
+      if (!g_utf8_validate(value.c_str(), static_cast<gssize>(value.size()),
+                           nullptr)) {
+        return nullptr;
+      }
+      return g_variant_new_string(value.c_str());
+    }
+    case js_arg::kind::number:
+      return g_variant_new_double(arg.get_number());
+    case js_arg::kind::boolean:
+      return g_variant_new_boolean(arg.get_boolean() ? TRUE : FALSE);
+    default:
+      return nullptr;
+    }
+  }
+
+#if defined(WEBVIEW_GTK_STRUCTURED_MESSAGES) &&                                \
+    ((WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 38) ||              \
+     WEBKIT_MAJOR_VERSION > 2)
+  // Handles a message posted by JS. Binding calls arrive as objects while
+  // anything else is passed to on_message() as a string.
+  void on_message_value(JSCValue *message) {
+    if (!jsc_value_is_object(message) || jsc_value_is_array(message)) {
+      on_message(webkitgtk_compat::get_string_from_js_result(message));
+      return;
+    }
+    trace_scope scope{"ipc", "on_message"};
+    auto id = get_string_property(message, "id");
+    auto name = get_string_property(message, "method");
+    if (tracer::instance().is_enabled()) {
+      auto *ts = jsc_value_object_get_property(message, "ts");
+      if (jsc_value_is_number(ts)) {
+        trace_post(id, jsc_value_to_double(ts));
+      }
+      g_object_unref(ts);
+    }
+    auto *params = jsc_value_object_get_property(message, "params");
+    std::vector<buffer> buffers;
+    std::string args;
+    if (binding_accepts_buffers(name)) {
+      args = to_json(params, &buffers);
+    } else {
+      args = to_json(params, nullptr);
+    }
+    g_object_unref(params);
+    on_call(id, name, args, buffers);
+  }
+
+  static std::string get_string_property(JSCValue *object, const char *name) {
+    auto *value = jsc_value_object_get_property(object, name);
+    auto result = webkitgtk_compat::get_string_from_js_result(value);
+    g_object_unref(value);
+    return result;
+  }
+
+  // Serializes a value to JSON. When buffers is non-null, typed arrays and
+  // array buffers are copied into it and serialized as {"$buffer":<index>}.
+  static std::string to_json(JSCValue *value, std::vector<buffer> *buffers) {
+    if (buffers && jsc_value_is_typed_array(value)) {
+      gsize length{};
+      auto *data = jsc_value_typed_array_get_data(value, &length);
+      return add_buffer(
+          *buffers, buffer::copy(data, jsc_value_typed_array_get_size(value)));
+    }
+    if (buffers && jsc_value_is_array_buffer(value)) {
+      gsize size{};
+      auto *data = jsc_value_array_buffer_get_data(value, &size);
+      return add_buffer(*buffers, buffer::copy(data, size));
+    }
+    if (buffers && jsc_value_is_array(value)) {
+      auto *length_value = jsc_value_object_get_property(value, "length");
+      auto length = jsc_value_to_int32(length_value);
+      g_object_unref(length_value);
+      std::string json = "[";
+      for (gint32 i = 0; i < length; ++i) {
+        auto index = static_cast<guint>(i);
+        auto *item = jsc_value_object_get_property_at_index(value, index);
+        json += (i > 0 ? "," : "") + to_json(item, buffers);
+        g_object_unref(item);
+      }
+      return json + "]";
+    }
+    // Only plain objects are traversed since other objects such as dates may
+    // have a custom JSON representation.
+    if (buffers && jsc_value_is_object(value) &&
+        !jsc_value_is_function(value) &&
+        !jsc_value_object_has_property(value, "toJSON")) {
+      auto **names = jsc_value_object_enumerate_properties(value);
+      std::string json = "{";
+      for (auto **name = names; name && *name; ++name) {
+        auto *item = jsc_value_object_get_property(value, *name);
+        if (!jsc_value_is_undefined(item) && !jsc_value_is_function(item)) {
+          json += (json.size() > 1 ? "," : "") + json_escape(*name) + ":" +
+                  to_json(item, buffers);
+        }
+        g_object_unref(item);
+      }
+      g_strfreev(names);
+      return json + "}";
+    }
+    auto *json = jsc_value_to_json(value, 0);
+    if (!json) {
+      return "null";
+    }
+    std::string result{json};
+    g_free(json);
+    return result;
+  }
+
+  static std::string add_buffer(std::vector<buffer> &buffers, buffer data) {
+    buffers.emplace_back(std::move(data));
+    return "{\"$buffer\":" + std::to_string(buffers.size() - 1) + "}";
+  }
+#endif
+
+  void on_uri_scheme_request(WebKitURISchemeRequest *request) {
+    scheme_request req;
+    req.scheme = webkit_uri_scheme_request_get_scheme(request);
+    req.uri = webkit_uri_scheme_request_get_uri(request);
+    if (auto *path = webkit_uri_scheme_request_get_path(request)) {
+      req.path = path;
+    }
+#if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 36) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+    if (auto *method = webkit_uri_scheme_request_get_http_method(request)) {
+      req.method = method;
+    }
+    if (auto *headers = webkit_uri_scheme_request_get_http_headers(request)) {
+      soup_message_headers_foreach(
+          headers,
+          +[](const char *name, const char *value, gpointer arg) {
+            static_cast<scheme_headers_t *>(arg)->emplace(name, value);
+          },
+          &req.headers);
+    }
+#endif
+#if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 40) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+    if (auto *body = webkit_uri_scheme_request_get_http_body(request)) {
+      read_request_body(request, body, std::move(req));
+      g_object_unref(body);
+      return;
+    }
+#endif
+    finish_uri_scheme_request(request, handle_scheme_request(req));
+  }
+
+  // Returns the engine of the web view that made a request, if it still
+  // exists.
+  static gtk_webkit_engine *get_engine(WebKitURISchemeRequest *request) {
+    auto *web_view = webkit_uri_scheme_request_get_web_view(request);
+    if (!web_view) {
+      return nullptr;
+    }
+    return static_cast<gtk_webkit_engine *>(
+        g_object_get_data(G_OBJECT(web_view), "webview-engine"));
+  }
+
+  static void
+  finish_uri_scheme_request_without_handler(WebKitURISchemeRequest *request) {
+    auto *error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                                      "No handler for URI scheme");
+    webkit_uri_scheme_request_finish_error(request, error);
+    g_error_free(error);
+  }
+
+#if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 40) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+  // Reads the body of a request without blocking the main loop and then
+  // handles the request. The body is passed to the handler in the memory it
+  // was read into.
+  static void read_request_body(WebKitURISchemeRequest *request,
+                                GInputStream *body, scheme_request req) {
+    struct pending_request {
+      WebKitURISchemeRequest *request;
+      scheme_request req;
+    };
+    g_object_ref(request);
+    g_output_stream_splice_async(
+        g_memory_output_stream_new_resizable(), body,
+        static_cast<GOutputStreamSpliceFlags>(
+            G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+            G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET),
+        G_PRIORITY_DEFAULT, nullptr,
+        +[](GObject *object, GAsyncResult *res, gpointer arg) {
+          std::unique_ptr<pending_request> pending{
+              static_cast<pending_request *>(arg)};
+          auto *request = pending->request;
+          GError *error{};
+          if (g_output_stream_splice_finish(G_OUTPUT_STREAM(object), res,
+                                            &error) < 0) {
+            webkit_uri_scheme_request_finish_error(request, error);
+            g_error_free(error);
+          } else if (auto *engine = get_engine(request)) {
+            // The engine may have been destroyed while reading.
+            auto *bytes = g_memory_output_stream_steal_as_bytes(
+                G_MEMORY_OUTPUT_STREAM(object));
+            pending->req.body = wrap_bytes(bytes);
+            g_bytes_unref(bytes);
+            finish_uri_scheme_request(
+                request, engine->handle_scheme_request(pending->req));
+          } else {
+            finish_uri_scheme_request_without_handler(request);
+          }
+          g_object_unref(request);
+          g_object_unref(object);
+        },
+        new pending_request{request, std::move(req)});
+  }
+
+  // Creates a buffer that refers to the memory of the bytes without copying
+  // it.
+  static buffer wrap_bytes(GBytes *bytes) {
+    gsize size{};
+    auto *data = g_bytes_get_data(bytes, &size);
+    std::shared_ptr<GBytes> owner{g_bytes_ref(bytes), g_bytes_unref};
+    return buffer{data, size, std::move(owner)};
+  }
+#endif
+
+  static void finish_uri_scheme_request(WebKitURISchemeRequest *request,
+                                        const scheme_response &response) {
+    GInputStream *stream{};
+    gint64 size{};
+    if (response.body_generator) {
+      stream = generator_input_stream::create(response.body_generator);
+      size = -1;
+    } else {
+      auto *bytes = create_bytes(response.body);
+      stream = g_memory_input_stream_new_from_bytes(bytes);
+      g_bytes_unref(bytes);
+      size = static_cast<gint64>(response.body.size());
+    }
+    if (response.content_encoding == "gzip") {
+      auto *decompressor =
+          g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+      auto *decompressed =
+          g_converter_input_stream_new(stream, G_CONVERTER(decompressor));
+      g_object_unref(decompressor);
+      g_object_unref(stream);
+      stream = decompressed;
+      size = -1;
+    }
+#if (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 36) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+    auto *wk_response = webkit_uri_scheme_response_new(stream, size);
+    webkit_uri_scheme_response_set_status(
+        wk_response, static_cast<guint>(response.status), nullptr);
+    webkit_uri_scheme_response_set_content_type(
+        wk_response, response.content_type.c_str());
+    if (!response.headers.empty()) {
+      auto *headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+      for (const auto &header : response.headers) {
+        soup_message_headers_append(headers, header.first.c_str(),
+                                    header.second.c_str());
+      }
+      // Takes ownership of the headers.
+      webkit_uri_scheme_response_set_http_headers(wk_response, headers);
+    }
+    webkit_uri_scheme_request_finish_with_response(request, wk_response);
+    g_object_unref(wk_response);
+#else
+    // The status and headers cannot be set so errors are reported as such.
+    if (response.status >= 400) {
+      auto *error = g_error_new_literal(
+          G_IO_ERROR,
+          response.status == 404 ? G_IO_ERROR_NOT_FOUND : G_IO_ERROR_FAILED,
+          "Request failed");
+      webkit_uri_scheme_request_finish_error(request, error);
+      g_error_free(error);
+    } else {
+      webkit_uri_scheme_request_finish(request, stream, size,
+                                       response.content_type.c_str());
+    }
+#endif
+    g_object_unref(stream);
+  }
+
+  // Creates bytes that refer to the memory of the buffer without copying it.
+  static GBytes *create_bytes(const buffer &data) {
+    return g_bytes_new_with_free_func(
+        data.data(), data.size(),
+        +[](gpointer owner) {
+          delete static_cast<std::shared_ptr<const void> *>(owner);
+        },
+        new std::shared_ptr<const void>{data.owner()});
+  }
+
   void window_init(void *window) {
     m_window = static_cast<GtkWidget *>(window);
     if (owns_window()) {
@@ -291,18 +923,33 @@ private:
     // Initialize webview widget
     m_webview = webkit_web_view_new();
     g_object_ref_sink(m_webview);
+    g_object_set_data(G_OBJECT(m_webview), "webview-engine", this);
     WebKitUserContentManager *manager = m_user_content_manager =
         webkit_web_view_get_user_content_manager(WEBKIT_WEB_VIEW(m_webview));
+#if defined(WEBVIEW_GTK_STRUCTURED_MESSAGES) &&                                \
+    ((WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 38) ||              \
+     WEBKIT_MAJOR_VERSION > 2)
+    // Binding calls are posted as objects and decoded natively.
+    auto post_structured = true;
+    webkitgtk_compat::connect_script_message_value_received(
+        manager, "__webview__",
+        [this](WebKitUserContentManager *, JSCValue *message) {
+          on_message_value(message);
+        });
+#else
+    auto post_structured = false;
     webkitgtk_compat::connect_script_message_received(
         manager, "__webview__",
         [this](WebKitUserContentManager *, const std::string &r) {
           on_message(r);
         });
+#endif
     webkitgtk_compat::user_content_manager_register_script_message_handler(
         manager, "__webview__");
     add_init_script("function(message) {\n\
   return window.webkit.messageHandlers.__webview__.postMessage(message);\n\
-}");
+}",
+                    post_structured);
   }
 
   void window_settings(bool debug) {
@@ -331,16 +978,113 @@ private:
     return {};
   }
 
+  // Calls the function once from the main context at the given priority.
+  noresult add_idle(std::function<void()> f, gint priority) {
+    auto *source = g_idle_source_new();
+    g_source_set_priority(source, priority);
+    g_source_set_callback(
+        source,
+        (GSourceFunc)([](void *fn) -> int {
+          (*static_cast<dispatch_fn_t *>(fn))();
+          return G_SOURCE_REMOVE;
+        }),
+        new std::function<void()>(std::move(f)),
+        [](void *fn) { delete static_cast<dispatch_fn_t *>(fn); });
+    g_source_attach(source, m_context);
+    g_source_unref(source);
+    return {};
+  }
+
+  // Attaches a source to the main context and takes ownership of it.
+  unsigned int add_source(unsigned int id, GSource *source) {
+    g_source_attach(source, m_context);
+    m_sources.emplace(id, source);
+    return id;
+  }
+
+  void release_source(unsigned int id) {
+    auto found = m_sources.find(id);
+    if (found != m_sources.end()) {
+      auto *source = found->second;
+      m_sources.erase(found);
+      g_source_unref(source);
+    }
+  }
+
+  // Reports and clears a pending request to stop the event loop.
+  noresult take_stop_request() {
+    if (m_stop_run_loop) {
+      m_stop_run_loop = false;
+      return error_info{WEBVIEW_ERROR_CANCELED};
+    }
+    return {};
+  }
+
   void run_event_loop_while(std::function<bool()> fn) override {
     while (fn()) {
-      g_main_context_iteration(nullptr, TRUE);
+      iterate(true);
+    }
+  }
+
+  // Runs an iteration of the event loop. While the loop monitor is enabled,
+  // the steps of g_main_context_iteration() are run one by one in order to
+  // measure the dispatch phase separately from waiting for events.
+  void iterate(bool may_block) {
+    if (!get_loop_monitor().is_enabled() ||
+        !g_main_context_acquire(m_context)) {
+      g_main_context_iteration(m_context, may_block ? TRUE : FALSE);
+      return;
+    }
+    gint max_priority{};
+    g_main_context_prepare(m_context, &max_priority);
+    gint timeout{};
+    auto count = g_main_context_query(
+        m_context, max_priority, &timeout, m_iteration_fds.data(),
+        static_cast<gint>(m_iteration_fds.size()));
+    if (static_cast<std::size_t>(count) > m_iteration_fds.size()) {
+      m_iteration_fds.resize(static_cast<std::size_t>(count));
+      count = g_main_context_query(m_context, max_priority, &timeout,
+                                   m_iteration_fds.data(), count);
+    }
+    m_iteration_fds.resize(static_cast<std::size_t>(count));
+    auto poll = g_main_context_get_poll_func(m_context);
+    poll(m_iteration_fds.data(), static_cast<guint>(count),
+         may_block ? timeout : 0);
+    check_and_dispatch(max_priority, m_iteration_fds);
+    g_main_context_release(m_context);
+  }
+
+  // Dispatches the sources that are ready after polling, measuring the time
+  // spent while the loop monitor is enabled.
+  void check_and_dispatch(gint max_priority, std::vector<GPollFD> &fds) {
+    auto &monitor = get_loop_monitor();
+    if (!monitor.is_enabled()) {
+      if (g_main_context_check(m_context, max_priority, fds.data(),
+                               static_cast<gint>(fds.size()))) {
+        g_main_context_dispatch(m_context);
+      }
+      return;
+    }
+    auto pending = get_pending_dispatch_count();
+    auto start = loop_monitor::clock::now();
+    if (g_main_context_check(m_context, max_priority, fds.data(),
+                             static_cast<gint>(fds.size()))) {
+      g_main_context_dispatch(m_context);
     }
+    monitor.record_iteration(loop_monitor::clock::now() - start, pending);
   }
 
+  GMainContext *m_context{};
   GtkWidget *m_window{};
   GtkWidget *m_webview{};
   WebKitUserContentManager *m_user_content_manager{};
   bool m_stop_run_loop{};
+  std::map<unsigned int, GSource *> m_sources;
+  unsigned int m_last_source_id{};
+  std::vector<GPollFD> m_poll_fds;
+  std::vector<GPollFD> m_iteration_fds;
+  gint m_poll_max_priority{};
+  bool m_poll_prepared{};
   bool m_is_window_shown{};
 };
 
@@ -0,0 +1,361 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_BACKENDS_NULL_ENGINE_HH
+#define WEBVIEW_BACKENDS_NULL_ENGINE_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "../../macros.h"
+
+//
+// ====================================================================
+//
+// This implementation has no browser engine or windowing system and can be
+// used on any platform. It is meant for testing and benchmarking the parts
+// of the library that don't depend on a browser engine, e.g. bindings,
+// message handling, dispatching and script generation. Define WEBVIEW_NULL
+// to use it as the browser engine and build without any other backend.
+//
+// ====================================================================
+//
+
+#include "../../errors.hh"
+#include "../../types.hh"
+#include "../engine_base.hh"
+#include "../json.hh"
+#include "../scheme.hh"
+#include "../user_script.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace webview {
+namespace detail {
+
+// A backend that runs dispatched functions from an in-process queue and
+// captures scripts instead of evaluating them. It takes the place of the JS
+// side with post_message() and call(), which inject messages as if they had
+// been posted by the page.
+class null_engine : public engine_base {
+public:
+  using clock = std::chrono::steady_clock;
+
+  // Called with each script that would have been evaluated by a browser
+  // engine.
+  using script_handler_t = std::function<void(const std::string &js)>;
+
+  null_engine() : engine_base{false} {
+    add_init_script("function(message) {}");
+  }
+
+  // Same signature as the other backends so that the null engine can be used
+  // as the browser engine, see WEBVIEW_NULL.
+  null_engine(bool /*debug*/, void * /*window*/) : null_engine{} {}
+
+  null_engine(const null_engine &) = delete;
+  null_engine &operator=(const null_engine &) = delete;
+  null_engine(null_engine &&) = delete;
+  null_engine &operator=(null_engine &&) = delete;
+
+  virtual ~null_engine() { stop_stall_watchdog(); }
+
+  // Passes a message to the engine as if it had been posted by JS, e.g. a
+  // binding call such as {"id":"1","method":"add","params":[1,2]}.
+  void post_message(const std::string &msg) { on_message(msg); }
+
+  // Calls a binding as if it had been called by JS with the given JSON array
+  // of parameters. Returns the ID of the call, which is passed to the reply.
+  std::string call(const std::string &method, const std::string &params) {
+    auto id = std::to_string(++m_last_call_id);
+    post_message("{\"id\":" + json_escape(id) +
+                 ",\"method\":" + json_escape(method) +
+                 ",\"params\":" + params + "}");
+    return id;
+  }
+
+  // Runs the functions that are queued without waiting for more. Returns
+  // the number of functions that were run.
+  std::size_t run_pending() {
+    std::size_t count{};
+    while (run_one(clock::time_point{})) {
+      ++count;
+    }
+    return count;
+  }
+
+  // Captured scripts are passed to the handler instead of being kept when
+  // set, e.g. to avoid keeping them in benchmarks.
+  void set_script_handler(script_handler_t handler) {
+    m_script_handler = std::move(handler);
+  }
+
+  // Returns and forgets the scripts captured so far, in order.
+  std::vector<std::string> take_scripts() {
+    std::vector<std::string> scripts;
+    scripts.swap(m_scripts);
+    return scripts;
+  }
+
+  // The code of the user scripts that would be injected into new pages.
+  const std::vector<std::string> &get_user_scripts() const {
+    return m_user_script_codes;
+  }
+
+  const std::string &get_url() const { return m_url; }
+  const std::string &get_html() const { return m_html; }
+  const std::string &get_title() const { return m_title; }
+
+  // Makes a request on a registered URI scheme as if made by the page.
+  scheme_response request(const scheme_request &request) {
+    return handle_scheme_request(request);
+  }
+
+protected:
+  noresult navigate_impl(const std::string &url) override {
+    m_url = url;
+    m_html.clear();
+    return {};
+  }
+
+  result<void *> window_impl() override {
+    return error_info{WEBVIEW_ERROR_INVALID_STATE};
+  }
+
+  result<void *> widget_impl() override {
+    return error_info{WEBVIEW_ERROR_INVALID_STATE};
+  }
+
+  result<void *> browser_controller_impl() override {
+    return error_info{WEBVIEW_ERROR_INVALID_STATE};
+  }
+
+  noresult run_impl() override {
+    m_stop_run_loop = false;
+    while (!m_stop_run_loop) {
+      run_one(clock::time_point::max());
+    }
+    return {};
+  }
+
+  noresult terminate_impl() override {
+    return dispatch_impl([this] { m_stop_run_loop = true; });
+  }
+
+  noresult step_impl(int timeout_ms) override {
+    run_one(timeout_ms < 0
+                ? clock::time_point::max()
+                : clock::now() + std::chrono::milliseconds{timeout_ms});
+    if (m_stop_run_loop) {
+      m_stop_run_loop = false;
+      return error_info{WEBVIEW_ERROR_CANCELED};
+    }
+    return {};
+  }
+
+  noresult dispatch_impl(std::function<void()> f) override {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_queue.push_back(std::move(f));
+    }
+    m_cv.notify_one();
+    return {};
+  }
+
+  result<unsigned int> add_timer_impl(std::function<void()> fn,
+                                      unsigned int interval_ms,
+                                      bool repeat) override {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto id = ++m_last_source_id;
+    auto interval = std::chrono::milliseconds{interval_ms};
+    m_timers[id] = timer{clock::now() + interval, interval, repeat,
+                         std::move(fn)};
+    return id;
+  }
+
+  noresult remove_source_impl(unsigned int id) override {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (m_timers.erase(id) == 0) {
+      return error_info{WEBVIEW_ERROR_NOT_FOUND};
+    }
+    return {};
+  }
+
+  noresult set_title_impl(const std::string &title) override {
+    m_title = title;
+    return {};
+  }
+
+  noresult set_size_impl(int /*width*/, int /*height*/,
+                         webview_hint_t /*hints*/) override {
+    return {};
+  }
+
+  noresult set_html_impl(const std::string &html) override {
+    m_url.clear();
+    m_html = html;
+    return {};
+  }
+
+  noresult eval_impl(const std::string &js) override {
+    if (m_script_handler) {
+      m_script_handler(js);
+    } else {
+      m_scripts.push_back(js);
+    }
+    return {};
+  }
+
+  // Scripts are captured and complete as if they evaluated to undefined.
+  noresult eval_async_impl(const std::string &js,
+                           eval_callback_t callback) override {
+    eval_impl(js);
+    return dispatch_impl([callback] { callback(0, ""); });
+  }
+
+  noresult register_scheme_impl(const std::string & /*scheme*/) override {
+    return {};
+  }
+
+  user_script add_user_script_impl(const std::string &js) override {
+    m_user_script_codes.push_back(js);
+    // There is nothing to keep besides the code.
+    return user_script{js, user_script::impl_ptr{nullptr, nullptr}};
+  }
+
+  void remove_all_user_scripts_impl(
+      const std::list<user_script> & /*scripts*/) override {
+    m_user_script_codes.clear();
+  }
+
+  bool are_user_scripts_equal_impl(const user_script &first,
+                                   const user_script &second) override {
+    return &first == &second;
+  }
+
+  void run_event_loop_while(std::function<bool()> fn) override {
+    while (fn()) {
+      run_one(clock::time_point::max());
+    }
+  }
+
+private:
+  struct timer {
+    clock::time_point due;
+    clock::duration interval;
+    bool repeat;
+    std::function<void()> fn;
+  };
+
+  // Runs the next queued function or due timer, waiting until the deadline
+  // for one. Returns false if nothing was run.
+  bool run_one(clock::time_point deadline) {
+    std::function<void()> fn;
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      for (;;) {
+        if (!m_queue.empty()) {
+          fn = std::move(m_queue.front());
+          m_queue.pop_front();
+          break;
+        }
+        auto wake_up = deadline;
+        auto next = next_timer();
+        if (next != m_timers.end()) {
+          if (next->second.due <= clock::now()) {
+            fn = take_timer(next);
+            break;
+          }
+          wake_up = std::min(wake_up, next->second.due);
+        }
+        if (clock::now() >= wake_up) {
+          return false;
+        }
+        if (wake_up == clock::time_point::max()) {
+          m_cv.wait(lock);
+        } else {
+          m_cv.wait_until(lock, wake_up);
+        }
+      }
+    }
+    fn();
+    return true;
+  }
+
+  std::map<unsigned int, timer>::iterator next_timer() {
+    auto next = m_timers.end();
+    for (auto it = m_timers.begin(); it != m_timers.end(); ++it) {
+      if (next == m_timers.end() || it->second.due < next->second.due) {
+        next = it;
+      }
+    }
+    return next;
+  }
+
+  std::function<void()> take_timer(std::map<unsigned int, timer>::iterator it) {
+    auto fn = it->second.fn;
+    if (it->second.repeat) {
+      it->second.due += it->second.interval;
+    } else {
+      m_timers.erase(it);
+    }
+    return fn;
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_queue;
+  std::map<unsigned int, timer> m_timers;
+  unsigned int m_last_source_id{};
+  bool m_stop_run_loop{};
+  unsigned long long m_last_call_id{};
+  script_handler_t m_script_handler;
+  std::vector<std::string> m_scripts;
+  std::vector<std::string> m_user_script_codes;
+  std::string m_url;
+  std::string m_html;
+  std::string m_title;
+};
+
+} // namespace detail
+
+#ifdef WEBVIEW_NULL
+using browser_engine = detail::null_engine;
+#endif
+
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_BACKENDS_NULL_ENGINE_HH
@@ -318,6 +318,7 @@ public:
   }
 
   virtual ~win32_edge_engine() {
+    stop_stall_watchdog();
     if (m_com_handler) {
       m_com_handler->Release();
       m_com_handler = nullptr;
@@ -0,0 +1,263 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_BINDING_METRICS_HH
+#define WEBVIEW_DETAIL_BINDING_METRICS_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "histogram.hh"
+#include "json.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace webview {
+namespace detail {
+
+// Records calls of bindings while enabled. Latencies are recorded in
+// nanoseconds:
+// - queue_wait: from receiving the call until its handler starts.
+// - handler: the duration of the handler.
+// - resolve: from receiving the call until it is resolved.
+//
+// Histograms and counters are updated with atomics. Receiving and resolving
+// a call briefly locks one of several shards, chosen by call ID and binding
+// name, so that calls on different threads rarely contend. Calls that are
+// not resolved within max_pending_age(), or that exceed the number of
+// pending calls that are tracked, are forgotten and no longer in flight.
+class binding_metrics {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct binding_stats {
+    std::atomic<std::uint64_t> calls{};
+    std::atomic<std::uint64_t> in_flight{};
+    latency_histogram queue_wait;
+    latency_histogram handler;
+    latency_histogram resolve;
+  };
+
+  struct snapshot {
+    std::string name;
+    std::uint64_t calls{};
+    std::uint64_t in_flight{};
+    histogram_snapshot queue_wait;
+    histogram_snapshot handler;
+    histogram_snapshot resolve;
+  };
+
+  binding_metrics() = default;
+  binding_metrics(const binding_metrics &) = delete;
+  binding_metrics &operator=(const binding_metrics &) = delete;
+
+  bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+  void set_enabled(bool enabled) {
+    m_enabled.store(enabled, std::memory_order_relaxed);
+    if (!enabled) {
+      for (auto &shard : m_shards) {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        // Forgotten calls are no longer in flight.
+        for (auto &pending : shard.pending) {
+          pending.second.stats->in_flight.fetch_sub(1,
+                                                    std::memory_order_relaxed);
+        }
+        shard.pending.clear();
+      }
+    }
+  }
+
+  // Records a call and returns the stats of the binding so that the handler
+  // can be timed.
+  std::shared_ptr<binding_stats> call_received(const std::string &id,
+                                               const std::string &name,
+                                               clock::time_point received) {
+    std::shared_ptr<binding_stats> stats;
+    {
+      auto &shard = get_shard(name);
+      std::lock_guard<std::mutex> lock{shard.mutex};
+      auto &found = shard.bindings[name];
+      if (!found) {
+        found = std::make_shared<binding_stats>();
+      }
+      stats = found;
+    }
+    stats->calls.fetch_add(1, std::memory_order_relaxed);
+    stats->in_flight.fetch_add(1, std::memory_order_relaxed);
+    auto &shard = get_shard(id);
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    if (shard.pending.size() >= max_pending_per_shard) {
+      forget_stale_calls(shard, received);
+    }
+    shard.pending[id] = pending_call{stats, received};
+    return stats;
+  }
+
+  void call_resolved(const std::string &id, clock::time_point resolved) {
+    std::shared_ptr<binding_stats> stats;
+    clock::time_point received;
+    {
+      auto &shard = get_shard(id);
+      std::lock_guard<std::mutex> lock{shard.mutex};
+      auto found = shard.pending.find(id);
+      if (found == shard.pending.end()) {
+        return;
+      }
+      stats = std::move(found->second.stats);
+      received = found->second.received;
+      shard.pending.erase(found);
+    }
+    stats->in_flight.fetch_sub(1, std::memory_order_relaxed);
+    stats->resolve.record(to_ns(resolved - received));
+  }
+
+  // The number of calls that are waiting to be resolved.
+  std::size_t pending_calls() const {
+    std::size_t count{};
+    for (const auto &shard : m_shards) {
+      std::lock_guard<std::mutex> lock{shard.mutex};
+      count += shard.pending.size();
+    }
+    return count;
+  }
+
+  std::vector<snapshot> get_snapshots() const {
+    std::map<std::string, std::shared_ptr<binding_stats>> bindings;
+    for (const auto &shard : m_shards) {
+      std::lock_guard<std::mutex> lock{shard.mutex};
+      bindings.insert(shard.bindings.begin(), shard.bindings.end());
+    }
+    std::vector<snapshot> result;
+    result.reserve(bindings.size());
+    for (const auto &binding : bindings) {
+      const auto &stats = *binding.second;
+      snapshot s;
+      s.name = binding.first;
+      s.calls = stats.calls.load(std::memory_order_relaxed);
+      s.in_flight = stats.in_flight.load(std::memory_order_relaxed);
+      s.queue_wait = stats.queue_wait.snapshot();
+      s.handler = stats.handler.snapshot();
+      s.resolve = stats.resolve.snapshot();
+      result.push_back(std::move(s));
+    }
+    return result;
+  }
+
+  // How long a call is tracked while waiting to be resolved.
+  static clock::duration max_pending_age() { return std::chrono::minutes{1}; }
+
+  static const std::size_t shard_count = 16;
+  // The number of pending calls that are tracked per shard.
+  static const std::size_t max_pending_per_shard = 256;
+
+  // Serializes the snapshots as a JSON object keyed by binding name.
+  std::string to_json() const {
+    std::string json{"{"};
+    for (const auto &s : get_snapshots()) {
+      if (json.size() > 1) {
+        json += ',';
+      }
+      json += json_escape(s.name) + ":{\"calls\":" + std::to_string(s.calls) +
+              ",\"in_flight\":" + std::to_string(s.in_flight) +
+              ",\"queue_wait_ns\":" + histogram_to_json(s.queue_wait) +
+              ",\"handler_ns\":" + histogram_to_json(s.handler) +
+              ",\"resolve_ns\":" + histogram_to_json(s.resolve) + "}";
+    }
+    return json + "}";
+  }
+
+  static std::string histogram_to_json(const histogram_snapshot &h) {
+    return "{\"count\":" + std::to_string(h.count()) +
+           ",\"min\":" + std::to_string(h.min()) +
+           ",\"mean\":" + std::to_string(h.mean()) +
+           ",\"p50\":" + std::to_string(h.percentile(50)) +
+           ",\"p90\":" + std::to_string(h.percentile(90)) +
+           ",\"p99\":" + std::to_string(h.percentile(99)) +
+           ",\"max\":" + std::to_string(h.max()) + "}";
+  }
+
+  static std::uint64_t to_ns(clock::duration duration) {
+    auto ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
+  }
+
+private:
+  struct pending_call {
+    std::shared_ptr<binding_stats> stats;
+    clock::time_point received;
+  };
+
+  struct shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<binding_stats>> bindings;
+    std::unordered_map<std::string, pending_call> pending;
+  };
+
+  shard &get_shard(const std::string &key) {
+    return m_shards[std::hash<std::string>{}(key) % shard_count];
+  }
+
+  // Makes room in a full shard by forgetting calls that are too old, or the
+  // oldest call if none are.
+  static void forget_stale_calls(shard &s, clock::time_point now) {
+    auto oldest = s.pending.end();
+    for (auto it = s.pending.begin(); it != s.pending.end();) {
+      if (now - it->second.received > max_pending_age()) {
+        it->second.stats->in_flight.fetch_sub(1, std::memory_order_relaxed);
+        it = s.pending.erase(it);
+        continue;
+      }
+      if (oldest == s.pending.end() ||
+          it->second.received < oldest->second.received) {
+        oldest = it;
+      }
+      ++it;
+    }
+    if (s.pending.size() >= max_pending_per_shard &&
+        oldest != s.pending.end()) {
+      oldest->second.stats->in_flight.fetch_sub(1, std::memory_order_relaxed);
+      s.pending.erase(oldest);
+    }
+  }
+
+  std::atomic<bool> m_enabled{};
+  shard m_shards[shard_count];
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_BINDING_METRICS_HH
@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_BUFFER_HH
+#define WEBVIEW_DETAIL_BUFFER_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace webview {
+namespace detail {
+
+// An immutable sequence of bytes. Copies and slices of a buffer share the
+// memory of the original buffer.
+class buffer {
+public:
+  buffer() = default;
+
+  // Takes ownership of the contents of the string.
+  explicit buffer(std::string &&data) {
+    auto owner = std::make_shared<std::string>(std::move(data));
+    m_data = reinterpret_cast<const unsigned char *>(owner->data());
+    m_size = owner->size();
+    m_owner = std::move(owner);
+  }
+
+  // Refers to memory that is kept alive by the owner.
+  buffer(const void *data, std::size_t size, std::shared_ptr<const void> owner)
+      : m_owner{std::move(owner)},
+        m_data{static_cast<const unsigned char *>(data)}, m_size{size} {}
+
+  static buffer copy(const void *data, std::size_t size) {
+    return buffer{std::string(static_cast<const char *>(data), size)};
+  }
+
+  const unsigned char *data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  // Returns a buffer that refers to a part of this buffer without copying.
+  // The range is clamped to the size of this buffer.
+  buffer slice(std::size_t offset, std::size_t length) const {
+    if (offset > m_size) {
+      offset = m_size;
+    }
+    if (length > m_size - offset) {
+      length = m_size - offset;
+    }
+    return buffer{m_data + offset, length, m_owner};
+  }
+
+  std::string to_string() const {
+    return std::string(reinterpret_cast<const char *>(m_data), m_size);
+  }
+
+  // Returns the object that keeps the memory alive.
+  const std::shared_ptr<const void> &owner() const { return m_owner; }
+
+private:
+  std::shared_ptr<const void> m_owner;
+  const unsigned char *m_data{};
+  std::size_t m_size{};
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_BUFFER_HH
@@ -0,0 +1,366 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_COROUTINE_HH
+#define WEBVIEW_DETAIL_COROUTINE_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+// Coroutine support requires C++20 and is otherwise left out.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define WEBVIEW_HAVE_COROUTINES
+#endif
+#endif
+
+#ifdef WEBVIEW_HAVE_COROUTINES
+
+#include "../errors.hh"
+#include "../types.h"
+#include "pool_allocator.hh"
+#include "thread_pool.hh"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace webview {
+namespace detail {
+
+// Allocates coroutine frames from pools of blocks in size classes so that
+// coroutines started at high rates reuse memory instead of going to the heap.
+class frame_allocator {
+public:
+  static void *allocate(std::size_t size) {
+    auto index = size_class(size);
+    if (index < class_count) {
+      return pools()[index].allocate();
+    }
+    return ::operator new(size);
+  }
+
+  static void deallocate(void *p, std::size_t size) noexcept {
+    auto index = size_class(size);
+    if (index < class_count) {
+      pools()[index].deallocate(p);
+      return;
+    }
+    ::operator delete(p);
+  }
+
+private:
+  static constexpr std::size_t granularity = 64;
+  static constexpr std::size_t class_count = 16;
+
+  struct pool_ops {
+    void *(*allocate)();
+    void (*deallocate)(void *);
+  };
+
+  static std::size_t size_class(std::size_t size) {
+    return size == 0 ? 0 : (size - 1) / granularity;
+  }
+
+  template <std::size_t... I>
+  static const pool_ops *make_pools(std::index_sequence<I...>) {
+    static const pool_ops ops[] = {pool_ops{
+        [] { return block_pool<(I + 1) * granularity>::instance().allocate(); },
+        [](void *p) {
+          block_pool<(I + 1) * granularity>::instance().deallocate(p);
+        }}...};
+    return ops;
+  }
+
+  static const pool_ops *pools() {
+    static const auto *ops =
+        make_pools(std::make_index_sequence<class_count>{});
+    return ops;
+  }
+};
+
+// Makes a promise type allocate its coroutine frames with frame_allocator.
+struct frame_allocated {
+  static void *operator new(std::size_t size) {
+    return frame_allocator::allocate(size);
+  }
+
+  static void operator delete(void *p, std::size_t size) noexcept {
+    frame_allocator::deallocate(p, size);
+  }
+};
+
+template <typename T = void> class task;
+
+class task_promise_base : public frame_allocated {
+public:
+  struct final_awaiter {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      // Resumes the awaiting coroutine, if any, without growing the stack.
+      if (auto continuation = handle.promise().m_continuation) {
+        return continuation;
+      }
+      return std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  final_awaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { m_exception = std::current_exception(); }
+
+  void set_continuation(std::coroutine_handle<> continuation) {
+    m_continuation = continuation;
+  }
+
+protected:
+  void rethrow_if_failed() {
+    if (m_exception) {
+      std::rethrow_exception(m_exception);
+    }
+  }
+
+private:
+  std::coroutine_handle<> m_continuation;
+  std::exception_ptr m_exception;
+};
+
+template <typename T> class task_promise : public task_promise_base {
+public:
+  task<T> get_return_object();
+
+  void return_value(T value) { m_value.emplace(std::move(value)); }
+
+  T take_result() {
+    rethrow_if_failed();
+    return std::move(*m_value);
+  }
+
+private:
+  std::optional<T> m_value;
+};
+
+template <> class task_promise<void> : public task_promise_base {
+public:
+  task<void> get_return_object();
+
+  void return_void() {}
+
+  void take_result() { rethrow_if_failed(); }
+};
+
+// A lazily started coroutine that produces a value of type T. A task starts
+// when it is awaited and resumes the awaiting coroutine when it finishes.
+template <typename T> class task {
+public:
+  using promise_type = task_promise<T>;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  explicit task(handle_type handle) noexcept : m_handle{handle} {}
+  task(task &&other) noexcept : m_handle{std::exchange(other.m_handle, {})} {}
+  task &operator=(task &&other) noexcept {
+    if (this != &other) {
+      destroy();
+      m_handle = std::exchange(other.m_handle, {});
+    }
+    return *this;
+  }
+  task(const task &) = delete;
+  task &operator=(const task &) = delete;
+
+  ~task() { destroy(); }
+
+  auto operator co_await() && noexcept {
+    struct awaiter {
+      handle_type handle;
+
+      bool await_ready() noexcept { return !handle || handle.done(); }
+
+      std::coroutine_handle<>
+      await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().set_continuation(awaiting);
+        return handle;
+      }
+
+      T await_resume() { return handle.promise().take_result(); }
+    };
+    return awaiter{m_handle};
+  }
+
+private:
+  void destroy() {
+    if (m_handle) {
+      m_handle.destroy();
+      m_handle = {};
+    }
+  }
+
+  handle_type m_handle;
+};
+
+template <typename T> task<T> task_promise<T>::get_return_object() {
+  return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)};
+}
+
+inline task<void> task_promise<void>::get_return_object() {
+  return task<void>{
+      std::coroutine_handle<task_promise<void>>::from_promise(*this)};
+}
+
+// A coroutine that starts immediately and destroys itself when it finishes.
+struct detached_task {
+  struct promise_type : frame_allocated {
+    detached_task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+// Runs a task to completion without awaiting it, and calls the function with
+// a pointer to the result, or null and the exception thrown by the task.
+template <typename T, typename Fn>
+detached_task start_task(task<T> t, Fn on_done) {
+  std::optional<T> result;
+  std::exception_ptr exception;
+  try {
+    result.emplace(co_await std::move(t));
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  on_done(result ? &*result : nullptr, exception);
+}
+
+template <typename Fn> detached_task start_task(task<void> t, Fn on_done) {
+  std::exception_ptr exception;
+  try {
+    co_await std::move(t);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  on_done(exception);
+}
+
+// Resumes the awaiting coroutine on the main/GUI thread of a webview, or
+// continues directly if already there. If the webview drops the work without
+// running it, e.g. because it is being destroyed, the coroutine is resumed
+// where the work is dropped and co_await throws an exception with
+// WEBVIEW_ERROR_CANCELED instead of leaving the coroutine suspended forever.
+template <typename Engine> class ui_thread_awaitable {
+public:
+  explicit ui_thread_awaitable(Engine &engine) : m_engine{engine} {}
+
+  bool await_ready() const { return m_engine.is_ui_thread(); }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    auto r = std::make_shared<resumer>(handle, m_canceled);
+    auto res = m_engine.dispatch([r] { r->resume(); },
+                                 WEBVIEW_DISPATCH_PRIORITY_URGENT);
+    // The coroutine may have been resumed already, after which the
+    // awaitable must not be used.
+    if (!res.ok() && r->claim()) {
+      throw exception{res.error()};
+    }
+  }
+
+  void await_resume() const {
+    if (m_canceled) {
+      throw exception{WEBVIEW_ERROR_CANCELED,
+                      "The main/GUI thread dropped the coroutine"};
+    }
+  }
+
+private:
+  // Resumes the coroutine exactly once: when called, or when destroyed
+  // without having been called.
+  class resumer {
+  public:
+    resumer(std::coroutine_handle<> handle, bool &canceled)
+        : m_handle{handle}, m_canceled{canceled} {}
+    resumer(const resumer &) = delete;
+    resumer &operator=(const resumer &) = delete;
+
+    ~resumer() {
+      if (claim()) {
+        m_canceled = true;
+        m_handle.resume();
+      }
+    }
+
+    void resume() {
+      if (claim()) {
+        m_handle.resume();
+      }
+    }
+
+    bool claim() { return !m_claimed.exchange(true); }
+
+  private:
+    std::coroutine_handle<> m_handle;
+    bool &m_canceled;
+    std::atomic<bool> m_claimed{};
+  };
+
+  Engine &m_engine;
+  bool m_canceled{};
+};
+
+// Resumes the awaiting coroutine on a thread of a worker pool.
+class worker_pool_awaitable {
+public:
+  explicit worker_pool_awaitable(thread_pool &pool = thread_pool::shared())
+      : m_pool{pool} {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    m_pool.post([handle] { handle.resume(); });
+  }
+
+  void await_resume() const noexcept {}
+
+private:
+  thread_pool &m_pool;
+};
+
+inline worker_pool_awaitable resume_on_worker_pool() {
+  return worker_pool_awaitable{};
+}
+
+} // namespace detail
+} // namespace webview
+
+#endif // WEBVIEW_HAVE_COROUTINES
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_COROUTINE_HH
@@ -0,0 +1,153 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_DIRECTORY_MOUNT_HH
+#define WEBVIEW_DETAIL_DIRECTORY_MOUNT_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "buffer.hh"
+#include "mapped_file.hh"
+#include "scheme.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace webview {
+namespace detail {
+
+// Serves the files of a host directory. Files are read when requested rather
+// than memory-mapped, so that files truncated by other processes cannot crash
+// the program. Range requests only read the requested parts of the file, and
+// large files are read in chunks while they are being sent.
+class directory_mount {
+public:
+  explicit directory_mount(const std::string &root) : m_root{root} {
+    while (m_root.size() > 1 && m_root.back() == '/') {
+      m_root.pop_back();
+    }
+  }
+
+  const std::string &root() const { return m_root; }
+
+  // Maps the path of a request to a file path below the root directory.
+  // Returns false if the path tries to escape the root directory.
+  bool resolve(const std::string &request_path, std::string &file_path) const {
+    std::string path;
+    if (!percent_decode(request_path, path) ||
+        path.find('\0') != std::string::npos ||
+        path.find('\\') != std::string::npos) {
+      return false;
+    }
+    if (path.empty() || path.back() == '/') {
+      path += "index.html";
+    }
+    file_path = m_root;
+    std::size_t begin = 0;
+    while (begin < path.size()) {
+      auto end = path.find('/', begin);
+      if (end == std::string::npos) {
+        end = path.size();
+      }
+      auto segment = path.substr(begin, end - begin);
+      if (segment == "..") {
+        return false;
+      }
+      if (!segment.empty() && segment != ".") {
+        file_path += '/';
+        file_path += segment;
+      }
+      begin = end + 1;
+    }
+    return true;
+  }
+
+  scheme_response serve(const scheme_request &request) const {
+    scheme_response response;
+    std::string file_path;
+    if (!resolve(request.path, file_path)) {
+      response.status = 403;
+      return response;
+    }
+    // Symbolic links must not lead outside of the root directory.
+    std::string root;
+    std::string canonical_path;
+    if (!get_canonical_path(m_root, root) ||
+        !get_canonical_path(file_path, canonical_path)) {
+      response.status = 404;
+      return response;
+    }
+    if (!is_below(root, canonical_path)) {
+      response.status = 403;
+      return response;
+    }
+    std::uint64_t size{};
+    std::int64_t modified{};
+    if (!get_file_info(canonical_path, size, modified)) {
+      response.status = 404;
+      return response;
+    }
+    char etag[48];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+                  static_cast<unsigned long long>(size),
+                  static_cast<unsigned long long>(modified));
+    // The reader outlives this call when the body is streamed.
+    return make_resource_response(
+        request, size,
+        [canonical_path](std::uint64_t offset, std::size_t length,
+                         buffer &out) {
+          auto data = read_file(canonical_path, offset, length);
+          if (!data.ok()) {
+            return false;
+          }
+          out = data.value();
+          return true;
+        },
+        guess_mime_type(canonical_path), {}, etag, format_http_date(modified));
+  }
+
+private:
+  static bool is_below(const std::string &root, const std::string &path) {
+#ifdef _WIN32
+    const char separator = '\\';
+#else
+    const char separator = '/';
+#endif
+    if (path.compare(0, root.size(), root) != 0) {
+      return false;
+    }
+    return path.size() == root.size() || root.back() == separator ||
+           path[root.size()] == separator;
+  }
+
+  std::string m_root;
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_DIRECTORY_MOUNT_HH
@@ -0,0 +1,219 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_DISPATCH_QUEUE_HH
+#define WEBVIEW_DETAIL_DISPATCH_QUEUE_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "../types.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace webview {
+namespace detail {
+
+// Queues of work dispatched to the main/GUI thread, one per priority class.
+// Each non-empty queue is pumped by a single task scheduled on the loop of
+// the backend at a matching priority. Work may be pushed from any thread.
+class dispatch_queues {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct queue_stats {
+    // Work that has been run.
+    std::uint64_t dispatched{};
+    // Work that was dropped because its deadline had passed.
+    std::uint64_t dropped{};
+    // Time between pushing and running work, in microseconds.
+    std::uint64_t total_wait_us{};
+    std::uint64_t max_wait_us{};
+    // Work waiting to be run.
+    std::size_t pending{};
+  };
+
+  struct stats {
+    queue_stats urgent;
+    queue_stats normal;
+    queue_stats background;
+  };
+
+  // Adds work to a queue. Returns true if the queue must be pumped with
+  // pump(), i.e. it was idle.
+  bool push(webview_dispatch_priority_t priority, std::function<void()> fn,
+            clock::time_point deadline = clock::time_point::max()) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (m_is_closed) {
+      return false;
+    }
+    auto &q = get_queue(priority);
+    q.items.push_back({std::move(fn), clock::now(), deadline});
+    if (q.is_scheduled) {
+      return false;
+    }
+    q.is_scheduled = true;
+    return true;
+  }
+
+  // Marks a queue as idle after scheduling its pump has failed, so that the
+  // next push() schedules it again.
+  void unschedule(webview_dispatch_priority_t priority) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    get_queue(priority).is_scheduled = false;
+  }
+
+  // Whether a queue is waiting for a pump.
+  bool is_scheduled(webview_dispatch_priority_t priority) const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return get_queue(priority).is_scheduled;
+  }
+
+  // Runs work from a queue on the calling thread. Background work runs one
+  // item at a time while other queues run the work that was queued when
+  // called. Returns true if the queue must be pumped again. If the work
+  // throws, the exception is passed on and is_scheduled() tells whether the
+  // queue must be pumped again.
+  bool pump(webview_dispatch_priority_t priority) {
+    try {
+      run_work(priority);
+    } catch (...) {
+      update_is_scheduled(priority);
+      throw;
+    }
+    return update_is_scheduled(priority);
+  }
+
+  // Drops all queued work and stops scheduling pumps, e.g. on destruction of
+  // the engine that pumps the queues.
+  void close() {
+    std::deque<item> dropped[3];
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_is_closed = true;
+      for (int i = 0; i < 3; ++i) {
+        dropped[i].swap(m_queues[i].items);
+      }
+    }
+    // The work is destroyed outside of the lock in case it dispatches more.
+  }
+
+  stats get_stats() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    stats result;
+    result.urgent = get_stats(WEBVIEW_DISPATCH_PRIORITY_URGENT);
+    result.normal = get_stats(WEBVIEW_DISPATCH_PRIORITY_NORMAL);
+    result.background = get_stats(WEBVIEW_DISPATCH_PRIORITY_BACKGROUND);
+    return result;
+  }
+
+private:
+  struct item {
+    std::function<void()> fn;
+    clock::time_point enqueued;
+    clock::time_point deadline;
+  };
+
+  struct queue {
+    std::deque<item> items;
+    queue_stats stats;
+    bool is_scheduled{};
+  };
+
+  queue &get_queue(webview_dispatch_priority_t priority) {
+    return m_queues[static_cast<int>(priority)];
+  }
+
+  const queue &get_queue(webview_dispatch_priority_t priority) const {
+    return m_queues[static_cast<int>(priority)];
+  }
+
+  void run_work(webview_dispatch_priority_t priority) {
+    std::size_t budget{};
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      budget = priority == WEBVIEW_DISPATCH_PRIORITY_BACKGROUND
+                   ? 1
+                   : get_queue(priority).items.size();
+    }
+    while (budget > 0) {
+      item work;
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto &q = get_queue(priority);
+        if (m_is_closed || q.items.empty()) {
+          break;
+        }
+        work = std::move(q.items.front());
+        q.items.pop_front();
+        auto now = clock::now();
+        if (now > work.deadline) {
+          ++q.stats.dropped;
+          continue;
+        }
+        auto wait = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                now - work.enqueued)
+                .count());
+        ++q.stats.dispatched;
+        q.stats.total_wait_us += wait;
+        if (wait > q.stats.max_wait_us) {
+          q.stats.max_wait_us = wait;
+        }
+      }
+      --budget;
+      work.fn();
+    }
+  }
+
+  bool update_is_scheduled(webview_dispatch_priority_t priority) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto &q = get_queue(priority);
+    q.is_scheduled = !m_is_closed && !q.items.empty();
+    return q.is_scheduled;
+  }
+
+  queue_stats get_stats(webview_dispatch_priority_t priority) const {
+    const auto &q = m_queues[static_cast<int>(priority)];
+    auto result = q.stats;
+    result.pending = q.items.size();
+    return result;
+  }
+
+  mutable std::mutex m_mutex;
+  queue m_queues[3];
+  bool m_is_closed{};
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_DISPATCH_QUEUE_HH
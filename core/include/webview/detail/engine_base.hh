@@ -31,23 +31,58 @@
 #include "../errors.hh"
 #include "../types.h"
 #include "../types.hh"
+#include "asset_bundle.hh"
+#include "binding_metrics.hh"
+#include "buffer.hh"
+#include "coroutine.hh"
+#include "directory_mount.hh"
+#include "dispatch_queue.hh"
+#include "idle_scheduler.hh"
+#include "js_arg.hh"
+#include "pool_allocator.hh"
+#include "probes.hh"
+#include "response_cache.hh"
+#include "scheme.hh"
+#include "stall_watchdog.hh"
+#include "tracer.hh"
 #include "json.hh"
+#include "loop_monitor.hh"
 #include "user_script.hh"
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
 #include <functional>
+#include <future>
 #include <list>
 #include <map>
+#include <memory>
+#include <random>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace webview {
 namespace detail {
 
+// The type returned when calling a function object without arguments, as
+// std::result_of was removed in C++20 and std::invoke_result needs C++17.
+template <typename Fn>
+using call_result_t = decltype(std::declval<Fn &>()());
+
 class engine_base {
 public:
   engine_base(bool owns_window) : m_owns_window{owns_window} {}
 
-  virtual ~engine_base() = default;
+  virtual ~engine_base() {
+    stop_stall_watchdog();
+    m_dispatch_queues->close();
+  }
 
   noresult navigate(const std::string &url) {
     if (url.empty()) {
@@ -57,19 +92,32 @@ public:
   }
 
   using binding_t = std::function<void(std::string, std::string, void *)>;
+  using buffer_binding_t =
+      std::function<void(const std::string &, const std::string &,
+                         const std::vector<buffer> &, void *)>;
   class binding_ctx_t {
   public:
     binding_ctx_t(binding_t callback, void *arg)
         : m_callback(callback), m_arg(arg) {}
-    void call(std::string id, std::string args) const {
+    binding_ctx_t(buffer_binding_t callback, void *arg)
+        : m_buffer_callback(callback), m_arg(arg) {}
+    void call(std::string id, std::string args,
+              const std::vector<buffer> &buffers) const {
       if (m_callback) {
         m_callback(id, args, m_arg);
+      } else if (m_buffer_callback) {
+        m_buffer_callback(id, args, buffers, m_arg);
       }
     }
+    bool accepts_buffers() const {
+      return static_cast<bool>(m_buffer_callback);
+    }
 
   private:
     // This function is called upon execution of the bound JS function
     binding_t m_callback;
+    // Same as above but also receives binary parameters
+    buffer_binding_t m_buffer_callback;
     // This user-supplied argument is passed to the callback
     void *m_arg;
   };
@@ -85,19 +133,53 @@ public:
 
   // Asynchronous bind
   noresult bind(const std::string &name, binding_t fn, void *arg) {
-    // NOLINTNEXTLINE(readability-container-contains): contains() requires C++20
-    if (bindings.count(name) > 0) {
-      return error_info{WEBVIEW_ERROR_DUPLICATE};
-    }
-    bindings.emplace(name, binding_ctx_t(fn, arg));
-    replace_bind_script();
-    // Notify that a binding was created if the init script has already
-    // set things up.
-    eval("if (window.__webview__) {\n\
-window.__webview__.onBind(" +
-         json_escape(name) + ")\n\
-}");
-    return {};
+    return add_binding(name, binding_ctx_t(fn, arg));
+  }
+
+#ifdef WEBVIEW_HAVE_COROUTINES
+  using task_binding_t = std::function<task<std::string>(std::string req)>;
+
+  // Binds a coroutine that returns a task, e.g.
+  // [](std::string req) -> task<std::string> { co_return ...; }. The call is
+  // resolved with the JSON produced by the task, or rejected with the message
+  // of an exception thrown by the task. The webview must outlive the task.
+  noresult bind_task(const std::string &name, task_binding_t fn) {
+    auto wrapper = [this, fn](const std::string &id, const std::string &req,
+                              void * /*arg*/) {
+      start_task(fn(req), [this, id](std::string *result,
+                                     std::exception_ptr error) {
+        if (result) {
+          resolve(id, 0, *result);
+          return;
+        }
+        std::string message{"Unknown error"};
+        try {
+          std::rethrow_exception(error);
+        } catch (const std::exception &e) {
+          message = e.what();
+        } catch (...) {
+        }
+        resolve(id, 1, json_escape(message));
+      });
+    };
+    return bind(name, wrapper, nullptr);
+  }
+
+  // Continues a coroutine on the main/GUI thread when awaited, e.g.
+  // co_await w.resume_on_ui_thread().
+  ui_thread_awaitable<engine_base> resume_on_ui_thread() {
+    return ui_thread_awaitable<engine_base>{*this};
+  }
+#endif
+
+  // Asynchronous bind with binary parameters. When supported by the backend,
+  // typed array and ArrayBuffer parameters are passed as buffers and are
+  // replaced by {"$buffer":<index>} in the JSON array of parameters, where
+  // <index> is the position of the buffer in the list of buffers. Otherwise
+  // the list of buffers is empty and the parameters are serialized as usual.
+  noresult bind_buffers(const std::string &name, buffer_binding_t fn,
+                        void *arg) {
+    return add_binding(name, binding_ctx_t(fn, arg));
   }
 
   noresult unbind(const std::string &name) {
@@ -109,24 +191,36 @@ window.__webview__.onBind(" +
     replace_bind_script();
     // Notify that a binding was created if the init script has already
     // set things up.
-    eval("if (window.__webview__) {\n\
-window.__webview__.onUnbind(" +
-         json_escape(name) + ")\n\
-}");
+    call_js("if (window.__webview__) {\n\
+  window.__webview__.onUnbind(name);\n\
+}",
+            {{"name", name}});
     return {};
   }
 
   noresult resolve(const std::string &id, int status,
                    const std::string &result) {
-    // NOLINTNEXTLINE(modernize-avoid-bind): Lambda with move requires C++14
-    return dispatch(std::bind(
-        [id, status, this](std::string escaped_result) {
-          std::string js = "window.__webview__.onReply(" + json_escape(id) +
-                           ", " + std::to_string(status) + ", " +
-                           escaped_result + ")";
-          eval(js);
-        },
-        result.empty() ? "undefined" : json_escape(result)));
+    WEBVIEW_PROBE3(resolve, id.c_str(), status, result.size());
+    if (m_binding_metrics.is_enabled()) {
+      m_binding_metrics.call_resolved(id, binding_metrics::clock::now());
+    }
+    auto resolved = tracer::clock::now();
+    return dispatch([id, status, result, resolved, this] {
+      auto &trace = tracer::instance();
+      if (trace.is_enabled()) {
+        trace.record("ipc", "reply_queue", resolved, tracer::clock::now(), id);
+        tracer::current_call_id() = id;
+      }
+      WEBVIEW_PROBE3(reply, id.c_str(), status, result.size());
+      {
+        trace_scope scope{"ipc", "reply_eval", id};
+        // An empty result means undefined.
+        call_js("window.__webview__.onReply(id, status,\n\
+  result === '' ? undefined : result);",
+                {{"id", id}, {"status", status}, {"result", result}});
+      }
+      tracer::current_call_id().clear();
+    });
   }
 
   result<void *> window() { return window_impl(); }
@@ -134,7 +228,252 @@ window.__webview__.onUnbind(" +
   result<void *> browser_controller() { return browser_controller_impl(); }
   noresult run() { return run_impl(); }
   noresult terminate() { return terminate_impl(); }
-  noresult dispatch(std::function<void()> f) { return dispatch_impl(f); }
+
+  // Runs a single iteration of the event loop, waiting up to the given number
+  // of milliseconds for events; a negative timeout waits indefinitely.
+  // Fails with WEBVIEW_ERROR_CANCELED after terminate() has been called.
+  noresult step(int timeout_ms) { return step_impl(timeout_ms); }
+
+  // Prepares an iteration of the event loop for an external reactor. Returns
+  // the file descriptors to poll in the given vector and the maximum number
+  // of milliseconds to wait, or -1 to wait indefinitely. After polling, pass
+  // the descriptors with their revents set to poll_dispatch().
+  result<int> poll_prepare(std::vector<webview_poll_fd_t> &fds) {
+    return poll_prepare_impl(fds);
+  }
+
+  // Completes an iteration prepared with poll_prepare(). Fails with
+  // WEBVIEW_ERROR_CANCELED after terminate() has been called.
+  noresult poll_dispatch(const std::vector<webview_poll_fd_t> &fds) {
+    return poll_dispatch_impl(fds);
+  }
+  noresult dispatch(std::function<void()> f) {
+    return dispatch(std::move(f), WEBVIEW_DISPATCH_PRIORITY_NORMAL);
+  }
+
+  // Dispatches work in a priority class. Work that has not started by the
+  // deadline is dropped without being called. Only backends that override
+  // schedule_impl() (GTK) order the classes; others run them in FIFO order.
+  noresult dispatch(std::function<void()> f,
+                    webview_dispatch_priority_t priority,
+                    dispatch_queues::clock::time_point deadline =
+                        dispatch_queues::clock::time_point::max()) {
+    if (priority < WEBVIEW_DISPATCH_PRIORITY_URGENT ||
+        priority > WEBVIEW_DISPATCH_PRIORITY_BACKGROUND) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    WEBVIEW_PROBE1(dispatch, static_cast<int>(priority));
+    if (m_stall_watchdog->is_enabled()) {
+      auto watchdog = m_stall_watchdog;
+      auto *site = dispatch_site(f);
+      f = [f, watchdog, site] {
+        stall_watchdog::task_scope scope{*watchdog, "dispatch", site};
+        f();
+      };
+    }
+    auto &trace = tracer::instance();
+    if (trace.is_enabled()) {
+      auto enqueued = tracer::clock::now();
+      f = [f, enqueued, &trace] {
+        trace.record("dispatch", "queue", enqueued, tracer::clock::now());
+        trace_scope scope{"dispatch", "task"};
+        f();
+      };
+    }
+    if (m_dispatch_queues->push(priority, std::move(f), deadline)) {
+      return schedule_dispatch_pump(priority);
+    }
+    return {};
+  }
+
+  // Calls the function on the main/GUI thread and returns a future for its
+  // result. Exceptions thrown by the function, or a failure to dispatch it,
+  // are stored in the future. The promise is allocated from a pool.
+  template <typename Fn>
+  std::future<call_result_t<Fn>>
+  dispatch_future(Fn fn, webview_dispatch_priority_t priority =
+                             WEBVIEW_DISPATCH_PRIORITY_NORMAL) {
+    using promise_t = std::promise<call_result_t<Fn>>;
+    pool_allocator<promise_t> allocator;
+    auto promise = std::allocate_shared<promise_t>(
+        allocator, std::allocator_arg, allocator);
+    auto future = promise->get_future();
+    auto res = dispatch(
+        [promise, fn]() mutable { fulfill_promise(*promise, fn); }, priority);
+    if (!res.ok()) {
+      promise->set_exception(std::make_exception_ptr(exception{res.error()}));
+    }
+    return future;
+  }
+
+  // Calls the function on the main/GUI thread and waits for its result. The
+  // function is called directly when already on the main/GUI thread, where
+  // waiting would deadlock.
+  template <typename Fn>
+  call_result_t<Fn> dispatch_sync(Fn fn) {
+    if (is_ui_thread()) {
+      return fn();
+    }
+    return dispatch_future(std::move(fn), WEBVIEW_DISPATCH_PRIORITY_URGENT)
+        .get();
+  }
+
+  // Whether the calling thread is the main/GUI thread of the webview, i.e.
+  // the thread that created it.
+  bool is_ui_thread() const {
+    return std::this_thread::get_id() == m_ui_thread_id;
+  }
+
+  // Runs a long task on the main/GUI thread in slices of the idle budget,
+  // yielding to the loop between slices so that input and rendering stay
+  // responsive. The task is called with the deadline of the current slice
+  // and returns true while it has more work to do.
+  noresult post_idle_task(idle_scheduler::task_t task) {
+    if (!task) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    if (m_idle_scheduler.post(std::move(task))) {
+      return schedule_idle_slice();
+    }
+    return {};
+  }
+
+  // Sets the duration of each slice of idle tasks.
+  noresult set_idle_budget(std::chrono::microseconds budget) {
+    if (budget <= std::chrono::microseconds::zero()) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    m_idle_scheduler.set_budget(budget);
+    return {};
+  }
+
+  // Enables or disables recording of binding call metrics, which is disabled
+  // by default.
+  void set_metrics_enabled(bool enabled) {
+    m_binding_metrics.set_enabled(enabled);
+  }
+
+  const binding_metrics &get_binding_metrics() const {
+    return m_binding_metrics;
+  }
+
+  // Enables or disables the process-wide tracer and the recording of
+  // JavaScript timestamps of binding calls in this webview.
+  void set_tracing_enabled(bool enabled) {
+    tracer::instance().set_enabled(enabled);
+    auto js = std::string{"if (window.__webview__) {\n\
+  window.__webview__.tracing = "} +
+              (enabled ? "true" : "false") + ";\n}";
+    if (m_tracing_script) {
+      m_tracing_script = replace_user_script(*m_tracing_script, js);
+    } else {
+      m_tracing_script = add_user_script(js);
+    }
+    eval(js);
+  }
+
+  // Returns the events recorded by the tracer in the Chrome trace event
+  // format.
+  std::string get_trace_json() const { return tracer::instance().to_json(); }
+
+  // Starts a watchdog thread that reports dispatched functions, binding
+  // handlers and other work that blocks the main/GUI thread for at least the
+  // threshold. The callback is called on the watchdog thread and must not
+  // call this function. A threshold of zero stops the watchdog.
+  noresult set_stall_watchdog(std::chrono::milliseconds threshold,
+                              stall_watchdog::callback_t callback = {}) {
+    if (threshold < std::chrono::milliseconds::zero()) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    if (threshold == std::chrono::milliseconds::zero()) {
+      m_stall_watchdog->stop();
+      return {};
+    }
+    m_stall_watchdog->start(
+        threshold,
+        [this](std::function<void()> f) {
+          dispatch(std::move(f), WEBVIEW_DISPATCH_PRIORITY_URGENT);
+        },
+        std::move(callback));
+    return {};
+  }
+
+  stall_watchdog::stats get_stall_stats() const {
+    return m_stall_watchdog->get_stats();
+  }
+
+  // Enables or disables measuring the iterations of the event loop, which is
+  // disabled by default. Only iterations of loops run by the library, e.g.
+  // with run(), step() or poll_dispatch(), are measured.
+  void set_loop_monitoring_enabled(bool enabled) {
+    m_loop_monitor->set_enabled(enabled);
+  }
+
+  loop_monitor::snapshot get_loop_stats() const {
+    return m_loop_monitor->get_snapshot();
+  }
+
+  // Returns binding call metrics, dispatch queue stats, stall counts and
+  // event loop stats as JSON.
+  std::string get_stats_json() const {
+    auto dispatch_stats = get_dispatch_stats();
+    return "{\"bindings\":" + m_binding_metrics.to_json() +
+           ",\"dispatch\":{\"urgent\":" +
+           queue_stats_to_json(dispatch_stats.urgent) +
+           ",\"normal\":" + queue_stats_to_json(dispatch_stats.normal) +
+           ",\"background\":" +
+           queue_stats_to_json(dispatch_stats.background) +
+           "},\"stalls\":" + stall_stats_to_json(get_stall_stats()) +
+           ",\"loop\":" + loop_stats_to_json(get_loop_stats()) + "}";
+  }
+
+  // Returns the number of dispatched functions and the time they waited
+  // before being called, per priority class.
+  dispatch_queues::stats get_dispatch_stats() const {
+    return m_dispatch_queues->get_stats();
+  }
+
+  using fd_watch_fn_t = std::function<void(unsigned short revents)>;
+
+  // Calls the function once on the main/GUI thread after the given delay.
+  // Returns an ID that can be passed to remove_source().
+  result<unsigned int> set_timeout(std::function<void()> fn,
+                                   unsigned int delay_ms) {
+    if (!fn) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    return add_timer_impl(owned_by_library(std::move(fn)), delay_ms, false);
+  }
+
+  // Calls the function repeatedly on the main/GUI thread at the given
+  // interval until the returned ID is passed to remove_source().
+  result<unsigned int> set_interval(std::function<void()> fn,
+                                    unsigned int interval_ms) {
+    if (!fn || interval_ms == 0) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    return add_timer_impl(owned_by_library(std::move(fn)), interval_ms, true);
+  }
+
+  // Calls the function on the main/GUI thread with the events that occurred
+  // whenever the file descriptor is ready for one of the given events, using
+  // the same flags as poll(). The watch remains until the returned ID is
+  // passed to remove_source(), or until the function has been called with
+  // POLLHUP, POLLERR or POLLNVAL, which would otherwise be reported forever.
+  result<unsigned int> watch_fd(int fd, unsigned short events,
+                                fd_watch_fn_t fn) {
+    if (fd < 0 || events == 0 || !fn) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    return watch_fd_impl(fd, events, [this, fn](unsigned short revents) {
+      loop_monitor::owned_scope scope{*m_loop_monitor};
+      fn(revents);
+    });
+  }
+
+  // Removes a timer or file descriptor watch. Timers that were created with
+  // set_timeout() are removed automatically after they have been called.
+  noresult remove_source(unsigned int id) { return remove_source_impl(id); }
   noresult set_title(const std::string &title) { return set_title_impl(title); }
 
   noresult set_size(int width, int height, webview_hint_t hints) {
@@ -145,12 +484,153 @@ window.__webview__.onUnbind(" +
 
   noresult set_html(const std::string &html) { return set_html_impl(html); }
 
+  // Takes ownership of the HTML, e.g. set_html(buffer{std::move(html)}),
+  // which avoids copying it when supported by the backend.
+  noresult set_html(buffer html) {
+    return set_html_buffer_impl(std::move(html));
+  }
+
   noresult init(const std::string &js) {
     add_user_script(js);
     return {};
   }
 
-  noresult eval(const std::string &js) { return eval_impl(js); }
+  noresult eval(const std::string &js) {
+    WEBVIEW_PROBE1(eval, js.size());
+    return eval_impl(js);
+  }
+
+  // Called with the status of the evaluation and the result. A status of zero
+  // means that the result is the JSON-serialized value of the script, or an
+  // empty string for undefined. Any other status means that the script threw
+  // an exception, in which case the result is the error message as a JSON
+  // string.
+  using eval_callback_t =
+      std::function<void(int status, const std::string &result)>;
+
+  noresult eval_async(const std::string &js, eval_callback_t callback) {
+    if (!callback) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    return eval_async_impl(js, std::move(callback));
+  }
+
+  // Calls a JS function with the given body and named arguments, e.g.
+  // call_js("console.log(a + b)", {{"a", 1}, {"b", 2}}). The arguments are
+  // passed separately from the code when supported by the backend, which
+  // avoids escaping and allows the engine to reuse the compiled code.
+  noresult call_js(const std::string &function_body, const js_args_t &args) {
+    return call_js_impl(function_body, args);
+  }
+
+  // Serves requests for resources on the given URI scheme, e.g. "app" for
+  // "app://...", with a native handler that is called on the UI thread.
+  noresult register_scheme(const std::string &scheme,
+                           scheme_handler_t handler) {
+    if (scheme.empty() || !handler) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    // NOLINTNEXTLINE(readability-container-contains): contains() requires C++20
+    if (m_scheme_handlers.count(scheme) > 0) {
+      return error_info{WEBVIEW_ERROR_DUPLICATE};
+    }
+    auto res = register_scheme_impl(scheme);
+    if (res.ok()) {
+      m_scheme_handlers.emplace(scheme, std::move(handler));
+    }
+    return res;
+  }
+
+  // Same as register_scheme() but successful responses to GET requests are
+  // kept in the response cache of this instance, so that the handler is only
+  // called again when the response has been evicted.
+  noresult register_cached_scheme(const std::string &scheme,
+                                  scheme_handler_t handler) {
+    if (!handler) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    return register_scheme(scheme, m_response_cache.wrap(std::move(handler)));
+  }
+
+  // The cache used by register_cached_scheme(), e.g. for setting the memory
+  // budget and reading hit/miss counters.
+  response_cache &get_response_cache() { return m_response_cache; }
+
+  // Serves the assets of a bundle on the given URI scheme, e.g. the entry
+  // "index.html" at "app://localhost/index.html" for the scheme "app".
+  noresult serve_asset_bundle(const std::string &scheme,
+                              const asset_bundle &bundle) {
+    auto shared_bundle = std::make_shared<asset_bundle>(bundle);
+    return register_scheme(scheme,
+                           [shared_bundle](const scheme_request &request) {
+                             return shared_bundle->serve(request);
+                           });
+  }
+
+  // Serves the files of a host directory on the given URI scheme, e.g. the
+  // file "<directory>/video.mp4" at "media://localhost/video.mp4" for the
+  // scheme "media". Range requests only read the requested part of a file.
+  noresult mount_directory(const std::string &scheme,
+                           const std::string &directory) {
+    if (directory.empty()) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    directory_mount mount{directory};
+    return register_scheme(scheme, [mount](const scheme_request &request) {
+      return mount.serve(request);
+    });
+  }
+
+  // Makes a buffer available to JS without encoding it. The returned URL can
+  // be fetched once, e.g. fetch(url).then(r => r.arrayBuffer()). The URL
+  // cannot be guessed, and buffers that have not been fetched in time are
+  // released.
+  result<std::string>
+  publish_buffer(buffer data,
+                 const std::string &content_type = "application/octet-stream") {
+    auto res = register_ipc_scheme();
+    if (!res.ok()) {
+      return res.error();
+    }
+    expire_published_buffers();
+    auto id = generate_ipc_token();
+    published_buffer published;
+    published.response.content_type = content_type;
+    published.response.body = std::move(data);
+    published.expires =
+        published_buffer::clock::now() + published_buffer::ttl();
+    m_published_buffers.emplace(id, std::move(published));
+    return "webview-ipc://localhost/buffer/" + id;
+  }
+
+  using binary_binding_t = std::function<buffer(const buffer &body)>;
+
+  // Binds a native function that JS can call with binary data, e.g.
+  // window.__webview__.callBinary(name, new Uint8Array([1, 2])), which
+  // resolves to an ArrayBuffer. The function receives the request body and
+  // returns the response body. Only pages with the init script can make
+  // such calls since the URL includes a token that cannot be guessed.
+  noresult bind_binary(const std::string &name, binary_binding_t fn) {
+    if (name.empty() || !fn) {
+      return error_info{WEBVIEW_ERROR_INVALID_ARGUMENT};
+    }
+    // NOLINTNEXTLINE(readability-container-contains): contains() requires C++20
+    if (m_binary_bindings.count(name) > 0) {
+      return error_info{WEBVIEW_ERROR_DUPLICATE};
+    }
+    auto res = register_ipc_scheme();
+    if (res.ok()) {
+      m_binary_bindings.emplace(name, std::move(fn));
+    }
+    return res;
+  }
+
+  noresult unbind_binary(const std::string &name) {
+    if (m_binary_bindings.erase(name) == 0) {
+      return error_info{WEBVIEW_ERROR_NOT_FOUND};
+    }
+    return {};
+  }
 
 protected:
   virtual noresult navigate_impl(const std::string &url) = 0;
@@ -160,12 +640,78 @@ protected:
   virtual noresult run_impl() = 0;
   virtual noresult terminate_impl() = 0;
   virtual noresult dispatch_impl(std::function<void()> f) = 0;
+
+  // Schedules work on the loop at a priority that matches the class. The
+  // default implementation ignores the priority.
+  virtual noresult schedule_impl(std::function<void()> f,
+                                 webview_dispatch_priority_t /*priority*/) {
+    return dispatch_impl(std::move(f));
+  }
   virtual noresult set_title_impl(const std::string &title) = 0;
   virtual noresult set_size_impl(int width, int height,
                                  webview_hint_t hints) = 0;
   virtual noresult set_html_impl(const std::string &html) = 0;
   virtual noresult eval_impl(const std::string &js) = 0;
 
+  virtual result<unsigned int> add_timer_impl(std::function<void()> /*fn*/,
+                                              unsigned int /*interval_ms*/,
+                                              bool /*repeat*/) {
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+  }
+
+  virtual result<unsigned int> watch_fd_impl(int /*fd*/,
+                                             unsigned short /*events*/,
+                                             fd_watch_fn_t /*fn*/) {
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+  }
+
+  virtual noresult remove_source_impl(unsigned int /*id*/) {
+    return error_info{WEBVIEW_ERROR_NOT_FOUND};
+  }
+
+  virtual noresult step_impl(int /*timeout_ms*/) {
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+  }
+
+  virtual result<int>
+  poll_prepare_impl(std::vector<webview_poll_fd_t> & /*fds*/) {
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+  }
+
+  virtual noresult
+  poll_dispatch_impl(const std::vector<webview_poll_fd_t> & /*fds*/) {
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+  }
+
+  virtual noresult set_html_buffer_impl(buffer html) {
+    return set_html_impl(html.to_string());
+  }
+
+  virtual noresult eval_async_impl(const std::string & /*js*/,
+                                   eval_callback_t /*callback*/) {
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+  }
+
+  virtual noresult call_js_impl(const std::string &function_body,
+                                const js_args_t &args) {
+    return eval(create_js_function_call(function_body, args));
+  }
+
+  virtual noresult register_scheme_impl(const std::string & /*scheme*/) {
+    return error_info{WEBVIEW_ERROR_NOT_SUPPORTED};
+  }
+
+  // Called by the backend for requests on registered URI schemes.
+  scheme_response handle_scheme_request(const scheme_request &request) {
+    auto found = m_scheme_handlers.find(request.scheme);
+    if (found == m_scheme_handlers.end()) {
+      scheme_response response;
+      response.status = 404;
+      return response;
+    }
+    return found->second(request);
+  }
+
   virtual user_script *add_user_script(const std::string &js) {
     return std::addressof(*m_user_scripts.emplace(m_user_scripts.end(),
                                                   add_user_script_impl(js)));
@@ -202,12 +748,17 @@ protected:
     }
   }
 
-  void add_init_script(const std::string &post_fn) {
-    add_user_script(create_init_script(post_fn));
+  // Set post_structured to have the JS side post binding calls as objects
+  // rather than JSON strings, which the backend then passes to on_call().
+  void add_init_script(const std::string &post_fn,
+                       bool post_structured = false) {
+    add_user_script(create_init_script(post_fn, post_structured));
     m_is_init_script_added = true;
   }
 
-  std::string create_init_script(const std::string &post_fn) {
+  std::string create_init_script(const std::string &post_fn,
+                                 bool post_structured = false) {
+    auto message = post_structured ? "message" : "JSON.stringify(message)";
     auto js = std::string{} + "(function() {\n\
   'use strict';\n\
   function generateId() {\n\
@@ -232,11 +783,16 @@ protected:
       var promise = new Promise(function(resolve, reject) {\n\
         _promises[_id] = { resolve, reject };\n\
       });\n\
-      this.post(JSON.stringify({\n\
+      var message = {\n\
         id: _id,\n\
         method: method,\n\
         params: _params\n\
-      }));\n\
+      };\n\
+      if (this.tracing) {\n\
+        message.ts = performance.timeOrigin + performance.now();\n\
+      }\n\
+      this.post(" +
+              message + ");\n\
       return promise;\n\
     };\n\
     Webview_.prototype.onReply = function(id, status, result) {\n\
@@ -255,6 +811,16 @@ protected:
         promise.reject(result);\n\
       }\n\
     };\n\
+    Webview_.prototype.callBinary = function(name, body) {\n\
+      var url = 'webview-ipc://localhost/call/' + " +
+              json_escape(m_ipc_token) + " + '/' + name;\n\
+      return fetch(url, { method: 'POST', body: body }).then(function(r) {\n\
+        if (!r.ok) {\n\
+          throw new Error('Binary call failed with status ' + r.status);\n\
+        }\n\
+        return r.arrayBuffer();\n\
+      });\n\
+    };\n\
     Webview_.prototype.onBind = function(name) {\n\
       if (window.hasOwnProperty(name)) {\n\
         throw new Error('Property \"' + name + '\" already exists');\n\
@@ -302,15 +868,79 @@ protected:
   }
 
   virtual void on_message(const std::string &msg) {
+    trace_scope scope{"ipc", "on_message"};
     auto id = json_parse(msg, "id", 0);
     auto name = json_parse(msg, "method", 0);
     auto args = json_parse(msg, "params", 0);
+    if (tracer::instance().is_enabled()) {
+      auto ts = json_parse(msg, "ts", 0);
+      if (!ts.empty()) {
+        trace_post(id, json_parse_number(ts));
+      }
+    }
+    on_call(id, name, args, {});
+  }
+
+  // Records the time from JS posting a call, at the given time in
+  // milliseconds since the Unix epoch, until it was received.
+  void trace_post(const std::string &id, double js_time_ms) {
+    tracer::instance().record_since_js_time("ipc", "post", js_time_ms,
+                                            tracer::clock::now(), id);
+  }
+
+  // Handles a binding call that the backend has already decoded.
+  void on_call(const std::string &id, const std::string &name,
+               const std::string &args, const std::vector<buffer> &buffers) {
     auto found = bindings.find(name);
     if (found == bindings.end()) {
       return;
     }
     const auto &context = found->second;
-    dispatch([=] { context.call(id, args); });
+    WEBVIEW_PROBE3(on_message, id.c_str(), name.c_str(), args.size());
+    if (m_binding_metrics.is_enabled()) {
+      using clock = binding_metrics::clock;
+      auto received = clock::now();
+      auto stats = m_binding_metrics.call_received(id, name, received);
+      dispatch([this, stats, received, context, id, name, args, buffers] {
+        auto start = clock::now();
+        stats->queue_wait.record(binding_metrics::to_ns(start - received));
+        call_binding(context, id, name, args, buffers);
+        stats->handler.record(binding_metrics::to_ns(clock::now() - start));
+      });
+      return;
+    }
+    dispatch([this, context, id, name, args, buffers] {
+      call_binding(context, id, name, args, buffers);
+    });
+  }
+
+  void call_binding(const binding_ctx_t &context, const std::string &id,
+                    const std::string &name, const std::string &args,
+                    const std::vector<buffer> &buffers) {
+    stall_watchdog::task_scope watch{*m_stall_watchdog, "binding",
+                                     name.c_str()};
+    trace_scope scope{"binding", "handler", id, name};
+    WEBVIEW_PROBE3(binding_entry, id.c_str(), name.c_str(), args.size());
+    context.call(id, args, buffers);
+    WEBVIEW_PROBE2(binding_return, id.c_str(), name.c_str());
+  }
+
+  loop_monitor &get_loop_monitor() { return *m_loop_monitor; }
+
+  // Returns the number of dispatched functions waiting to be called.
+  std::uint64_t get_pending_dispatch_count() const {
+    auto stats = get_dispatch_stats();
+    return stats.urgent.pending + stats.normal.pending +
+           stats.background.pending;
+  }
+
+  // Stops the watchdog thread, if any, so that it no longer posts to the
+  // loop. Backends call this first when destroyed.
+  void stop_stall_watchdog() { m_stall_watchdog->stop(); }
+
+  bool binding_accepts_buffers(const std::string &name) const {
+    auto found = bindings.find(name);
+    return found != bindings.end() && found->second.accepts_buffers();
   }
 
   virtual void on_window_created() { inc_window_count(); }
@@ -349,6 +979,224 @@ protected:
   bool owns_window() const { return m_owns_window; }
 
 private:
+  noresult add_binding(const std::string &name, binding_ctx_t context) {
+    // NOLINTNEXTLINE(readability-container-contains): contains() requires C++20
+    if (bindings.count(name) > 0) {
+      return error_info{WEBVIEW_ERROR_DUPLICATE};
+    }
+    bindings.emplace(name, std::move(context));
+    replace_bind_script();
+    // Notify that a binding was created if the init script has already
+    // set things up.
+    call_js("if (window.__webview__) {\n\
+  window.__webview__.onBind(name);\n\
+}",
+            {{"name", name}});
+    return {};
+  }
+
+  noresult register_ipc_scheme() {
+    // NOLINTNEXTLINE(readability-container-contains): contains() requires C++20
+    if (m_scheme_handlers.count("webview-ipc") > 0) {
+      return {};
+    }
+    return register_scheme("webview-ipc", [this](const scheme_request &req) {
+      return handle_ipc_request(req);
+    });
+  }
+
+  scheme_response handle_ipc_request(const scheme_request &request) {
+    static const std::string buffer_prefix{"/buffer/"};
+    static const std::string call_prefix{"/call/"};
+    expire_published_buffers();
+    scheme_response response;
+    // Only URLs with an ID or token that cannot be guessed are made
+    // available to the requesting origin.
+    bool allow_origin{};
+    if (request.path.compare(0, buffer_prefix.size(), buffer_prefix) == 0) {
+      auto found =
+          m_published_buffers.find(request.path.substr(buffer_prefix.size()));
+      if (found == m_published_buffers.end()) {
+        response.status = 404;
+      } else if (request.method == "OPTIONS") {
+        allow_origin = true;
+        set_preflight_response(response);
+      } else {
+        allow_origin = true;
+        response = std::move(found->second.response);
+        m_published_buffers.erase(found);
+      }
+    } else if (request.path.compare(0, call_prefix.size(), call_prefix) == 0) {
+      auto token_and_name = request.path.substr(call_prefix.size());
+      auto slash = token_and_name.find('/');
+      auto found = m_binary_bindings.end();
+      if (slash == m_ipc_token.size() &&
+          token_and_name.compare(0, slash, m_ipc_token) == 0) {
+        found = m_binary_bindings.find(token_and_name.substr(slash + 1));
+      }
+      if (found == m_binary_bindings.end()) {
+        response.status = 404;
+      } else if (request.method == "OPTIONS") {
+        allow_origin = true;
+        set_preflight_response(response);
+      } else if (request.method != "POST") {
+        response.status = 405;
+      } else {
+        allow_origin = true;
+        response.body = found->second(request.body);
+      }
+    } else {
+      response.status = 404;
+    }
+    auto origin = request.headers.find("Origin");
+    if (allow_origin && origin != request.headers.end()) {
+      response.headers["Access-Control-Allow-Origin"] = origin->second;
+      response.headers["Vary"] = "Origin";
+    }
+    return response;
+  }
+
+  // Response to a CORS preflight request.
+  static void set_preflight_response(scheme_response &response) {
+    response.status = 204;
+    response.headers["Access-Control-Allow-Methods"] = "GET, POST";
+    response.headers["Access-Control-Allow-Headers"] = "Content-Type";
+  }
+
+  // Returns 128 random bits in hex for IDs and tokens in URLs that pages
+  // must not be able to guess.
+  static std::string generate_ipc_token() {
+    std::random_device device;
+    // Mixed with the clock in case the device is deterministic.
+    std::seed_seq seed{
+        device(), device(), device(), device(),
+        static_cast<unsigned int>(
+            std::chrono::steady_clock::now().time_since_epoch().count())};
+    std::mt19937_64 generator{seed};
+    char token[33]{};
+    std::snprintf(token, sizeof(token), "%016llx%016llx",
+                  static_cast<unsigned long long>(generator()),
+                  static_cast<unsigned long long>(generator()));
+    return token;
+  }
+
+  void expire_published_buffers() {
+    auto now = published_buffer::clock::now();
+    for (auto it = m_published_buffers.begin();
+         it != m_published_buffers.end();) {
+      if (it->second.expires <= now) {
+        it = m_published_buffers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  noresult schedule_dispatch_pump(webview_dispatch_priority_t priority) {
+    // The queues outlive the engine in case the loop still has a pump.
+    auto queues = m_dispatch_queues;
+    auto monitor = m_loop_monitor;
+    auto res = schedule_impl(
+        [this, queues, monitor, priority] {
+          loop_monitor::owned_scope scope{*monitor};
+          try {
+            if (queues->pump(priority)) {
+              schedule_dispatch_pump(priority);
+            }
+          } catch (...) {
+            // Keep the remaining work going before passing the error on.
+            if (queues->is_scheduled(priority)) {
+              schedule_dispatch_pump(priority);
+            }
+            throw;
+          }
+        },
+        priority);
+    if (!res.ok()) {
+      // Let the next dispatch try to schedule the pump again.
+      queues->unschedule(priority);
+    }
+    return res;
+  }
+
+  template <typename T, typename Fn>
+  static void fulfill_promise(std::promise<T> &promise, Fn &fn) {
+    try {
+      promise.set_value(fn());
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+
+  template <typename Fn>
+  static void fulfill_promise(std::promise<void> &promise, Fn &fn) {
+    try {
+      fn();
+      promise.set_value();
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+
+  static std::string
+  queue_stats_to_json(const dispatch_queues::queue_stats &stats) {
+    return "{\"dispatched\":" + std::to_string(stats.dispatched) +
+           ",\"dropped\":" + std::to_string(stats.dropped) +
+           ",\"pending\":" + std::to_string(stats.pending) +
+           ",\"total_wait_us\":" + std::to_string(stats.total_wait_us) +
+           ",\"max_wait_us\":" + std::to_string(stats.max_wait_us) + "}";
+  }
+
+  static std::string stall_stats_to_json(const stall_watchdog::stats &stats) {
+    std::string sites;
+    for (const auto &site : stats.sites) {
+      sites += (sites.empty() ? "" : ",") + json_escape(site.first) + ":" +
+               std::to_string(site.second);
+    }
+    return "{\"count\":" + std::to_string(stats.count) +
+           ",\"total_us\":" + std::to_string(stats.total_us) +
+           ",\"max_us\":" + std::to_string(stats.max_us) + ",\"sites\":{" +
+           sites + "}}";
+  }
+
+  static std::string loop_stats_to_json(const loop_monitor::snapshot &stats) {
+    return "{\"iterations\":" + std::to_string(stats.iterations) +
+           ",\"busy_ns\":" + binding_metrics::histogram_to_json(stats.busy_ns) +
+           ",\"pending_dispatches\":" +
+           binding_metrics::histogram_to_json(stats.pending_dispatches) +
+           ",\"total_busy_ns\":" + std::to_string(stats.total_busy_ns) +
+           ",\"owned_busy_ns\":" + std::to_string(stats.owned_busy_ns) +
+           ",\"owned_share\":" + json_number(stats.owned_share(), 4) + "}";
+  }
+
+  std::function<void()> owned_by_library(std::function<void()> fn) {
+    return [this, fn] {
+      loop_monitor::owned_scope scope{*m_loop_monitor};
+      fn();
+    };
+  }
+
+  // Describes where a dispatched function comes from by the type of the
+  // callable, which for lambdas includes the enclosing function.
+  static const char *dispatch_site(const std::function<void()> &f) {
+#if defined(__cpp_rtti) || defined(__GXX_RTTI) || defined(_CPPRTTI)
+    return f.target_type().name();
+#else
+    (void)f;
+    return "function";
+#endif
+  }
+
+  noresult schedule_idle_slice() {
+    return dispatch(
+        [this] {
+          if (m_idle_scheduler.run_slice()) {
+            schedule_idle_slice();
+          }
+        },
+        WEBVIEW_DISPATCH_PRIORITY_BACKGROUND);
+  }
+
   static std::atomic_uint &window_ref_count() {
     static std::atomic_uint ref_count{0};
     return ref_count;
@@ -365,7 +1213,29 @@ private:
   }
 
   std::map<std::string, binding_ctx_t> bindings;
+  std::map<std::string, scheme_handler_t> m_scheme_handlers;
+  std::map<std::string, binary_binding_t> m_binary_bindings;
+  struct published_buffer {
+    using clock = std::chrono::steady_clock;
+    scheme_response response;
+    clock::time_point expires;
+    // How long published buffers are kept if they are not fetched.
+    static std::chrono::seconds ttl() { return std::chrono::seconds{60}; }
+  };
+  std::map<std::string, published_buffer> m_published_buffers;
+  std::string m_ipc_token{generate_ipc_token()};
+  response_cache m_response_cache;
+  std::shared_ptr<dispatch_queues> m_dispatch_queues{
+      std::make_shared<dispatch_queues>()};
+  idle_scheduler m_idle_scheduler;
+  binding_metrics m_binding_metrics;
+  std::shared_ptr<loop_monitor> m_loop_monitor{
+      std::make_shared<loop_monitor>()};
+  std::shared_ptr<stall_watchdog> m_stall_watchdog{
+      std::make_shared<stall_watchdog>()};
+  std::thread::id m_ui_thread_id{std::this_thread::get_id()};
   user_script *m_bind_script{};
+  user_script *m_tracing_script{};
   std::list<user_script> m_user_scripts;
 
   bool m_is_init_script_added{};
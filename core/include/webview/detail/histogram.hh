@@ -0,0 +1,186 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_HISTOGRAM_HH
+#define WEBVIEW_DETAIL_HISTOGRAM_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace webview {
+namespace detail {
+
+// The values recorded by a histogram at a point in time.
+class histogram_snapshot {
+public:
+  histogram_snapshot() = default;
+  histogram_snapshot(std::vector<std::uint64_t> counts, std::uint64_t count,
+                     std::uint64_t sum, std::uint64_t min, std::uint64_t max)
+      : m_counts{std::move(counts)},
+        m_count{count},
+        m_sum{sum},
+        m_min{min},
+        m_max{max} {}
+
+  std::uint64_t count() const { return m_count; }
+  std::uint64_t sum() const { return m_sum; }
+  std::uint64_t min() const { return m_count ? m_min : 0; }
+  std::uint64_t max() const { return m_max; }
+  std::uint64_t mean() const { return m_count ? m_sum / m_count : 0; }
+
+  // Returns the value below or at which the given percentage of the recorded
+  // values fall, within the precision of the histogram.
+  std::uint64_t percentile(double percent) const;
+
+private:
+  std::vector<std::uint64_t> m_counts;
+  std::uint64_t m_count{};
+  std::uint64_t m_sum{};
+  std::uint64_t m_min{};
+  std::uint64_t m_max{};
+};
+
+// A histogram of non-negative integers, e.g. latencies in nanoseconds, in the
+// style of HdrHistogram. Buckets are linear below 64 and log-linear above,
+// with 32 buckets per power of two, which bounds the relative error of
+// reported values to about 3%. Values are recorded without locks and may be
+// recorded from any thread.
+class latency_histogram {
+public:
+  // Larger values are recorded as this value.
+  static constexpr std::uint64_t max_value = (std::uint64_t{1} << 40) - 1;
+
+  latency_histogram() : m_counts(bucket_count) {}
+
+  latency_histogram(const latency_histogram &) = delete;
+  latency_histogram &operator=(const latency_histogram &) = delete;
+
+  void record(std::uint64_t value) {
+    if (value > max_value) {
+      value = max_value;
+    }
+    m_counts[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    auto min = m_min.load(std::memory_order_relaxed);
+    while (value < min && !m_min.compare_exchange_weak(
+                              min, value, std::memory_order_relaxed)) {
+    }
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(
+                              max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Values recorded concurrently may be partially included.
+  histogram_snapshot snapshot() const {
+    std::vector<std::uint64_t> counts(bucket_count);
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    }
+    return {std::move(counts), m_count.load(std::memory_order_relaxed),
+            m_sum.load(std::memory_order_relaxed),
+            m_min.load(std::memory_order_relaxed),
+            m_max.load(std::memory_order_relaxed)};
+  }
+
+  static constexpr unsigned int precision_bits = 6;
+  static constexpr std::size_t linear_count = std::size_t{1} << precision_bits;
+  static constexpr std::size_t half_count = linear_count / 2;
+  static constexpr std::size_t bucket_count =
+      linear_count + (40 - precision_bits) * half_count;
+
+  static std::size_t bucket_index(std::uint64_t value) {
+    if (value < linear_count) {
+      return static_cast<std::size_t>(value);
+    }
+    auto shift = most_significant_bit(value) - (precision_bits - 1);
+    auto sub_bucket = static_cast<std::size_t>(value >> shift);
+    return linear_count + (shift - 1) * half_count + (sub_bucket - half_count);
+  }
+
+  // The highest value that is recorded in the bucket.
+  static std::uint64_t bucket_upper_bound(std::size_t index) {
+    if (index < linear_count) {
+      return index;
+    }
+    auto shift = static_cast<unsigned int>((index - linear_count) / half_count +
+                                           1);
+    auto sub_bucket = (index - linear_count) % half_count + half_count;
+    return ((static_cast<std::uint64_t>(sub_bucket) + 1) << shift) - 1;
+  }
+
+private:
+  static unsigned int most_significant_bit(std::uint64_t value) {
+#if defined(__GNUC__)
+    return 63 - static_cast<unsigned int>(__builtin_clzll(value));
+#else
+    unsigned int bit = 0;
+    while (value >>= 1) {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+
+  std::vector<std::atomic<std::uint64_t>> m_counts;
+  std::atomic<std::uint64_t> m_count{};
+  std::atomic<std::uint64_t> m_sum{};
+  std::atomic<std::uint64_t> m_min{std::numeric_limits<std::uint64_t>::max()};
+  std::atomic<std::uint64_t> m_max{};
+};
+
+inline std::uint64_t histogram_snapshot::percentile(double percent) const {
+  if (m_count == 0) {
+    return 0;
+  }
+  auto target = static_cast<std::uint64_t>(
+      std::ceil(percent / 100.0 * static_cast<double>(m_count)));
+  if (target == 0) {
+    target = 1;
+  }
+  std::uint64_t seen{};
+  for (std::size_t i = 0; i < m_counts.size(); ++i) {
+    seen += m_counts[i];
+    if (seen >= target) {
+      auto value = latency_histogram::bucket_upper_bound(i);
+      return value < m_max ? value : m_max;
+    }
+  }
+  return m_max;
+}
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_HISTOGRAM_HH
@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_IDLE_SCHEDULER_HH
+#define WEBVIEW_DETAIL_IDLE_SCHEDULER_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace webview {
+namespace detail {
+
+// The end of the time slice given to an idle task.
+class idle_deadline {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit idle_deadline(clock::time_point end) : m_end{end} {}
+
+  clock::time_point end() const { return m_end; }
+
+  // The time left in the slice, or zero if it has run out.
+  std::chrono::microseconds time_remaining() const {
+    auto now = clock::now();
+    if (now >= m_end) {
+      return std::chrono::microseconds::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(m_end - now);
+  }
+
+  bool has_expired() const { return clock::now() >= m_end; }
+
+private:
+  clock::time_point m_end;
+};
+
+// Runs tasks cooperatively in time slices, similar to requestIdleCallback()
+// in browsers. A task does a bounded amount of work while time remains before
+// the deadline and returns true if it has more work to do, in which case it is
+// called again later, after the other tasks have had their turn.
+class idle_scheduler {
+public:
+  using task_t = std::function<bool(const idle_deadline &deadline)>;
+  using clock = idle_deadline::clock;
+
+  // The budget is the duration of each slice.
+  explicit idle_scheduler(
+      std::chrono::microseconds budget = std::chrono::milliseconds{8})
+      : m_budget{budget} {}
+
+  idle_scheduler(const idle_scheduler &) = delete;
+  idle_scheduler &operator=(const idle_scheduler &) = delete;
+
+  // Adds a task. Returns true if a slice must be scheduled with run_slice(),
+  // i.e. the scheduler was idle. May be called from any thread.
+  bool post(task_t task) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_tasks.push_back(std::move(task));
+    if (m_is_scheduled) {
+      return false;
+    }
+    m_is_scheduled = true;
+    return true;
+  }
+
+  // Runs tasks until the budget of the slice has been used. At least one
+  // task is called per slice. Returns true if another slice must be
+  // scheduled.
+  bool run_slice() {
+    idle_deadline deadline{clock::now() + get_budget()};
+    do {
+      task_t task;
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_tasks.empty()) {
+          break;
+        }
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+      }
+      if (task(deadline)) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push_back(std::move(task));
+      }
+    } while (!deadline.has_expired());
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_is_scheduled = !m_tasks.empty();
+    return m_is_scheduled;
+  }
+
+  std::chrono::microseconds get_budget() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_budget;
+  }
+
+  void set_budget(std::chrono::microseconds budget) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_budget = budget;
+  }
+
+  std::size_t pending() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_tasks.size();
+  }
+
+private:
+  mutable std::mutex m_mutex;
+  std::deque<task_t> m_tasks;
+  std::chrono::microseconds m_budget;
+  bool m_is_scheduled{};
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_IDLE_SCHEDULER_HH
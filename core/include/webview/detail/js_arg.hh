@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_JS_ARG_HH
+#define WEBVIEW_DETAIL_JS_ARG_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "json.hh"
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace webview {
+namespace detail {
+
+// A primitive value passed as a named argument to a JS function.
+class js_arg {
+public:
+  enum class kind { string, number, boolean };
+
+  js_arg(const std::string &value) : m_kind{kind::string}, m_string{value} {}
+  js_arg(std::string &&value)
+      : m_kind{kind::string}, m_string{std::move(value)} {}
+  js_arg(const char *value) : m_kind{kind::string}, m_string{value} {}
+  js_arg(bool value) : m_kind{kind::boolean}, m_boolean{value} {}
+
+  template <typename T, typename std::enable_if<
+                            std::is_arithmetic<T>::value &&
+                                !std::is_same<T, bool>::value,
+                            int>::type = 0>
+  js_arg(T value)
+      : m_kind{kind::number}, m_number{static_cast<double>(value)} {}
+
+  kind get_kind() const { return m_kind; }
+  const std::string &get_string() const { return m_string; }
+  double get_number() const { return m_number; }
+  bool get_boolean() const { return m_boolean; }
+
+  // Returns a JS expression that evaluates to the value.
+  std::string to_js() const {
+    switch (m_kind) {
+    case kind::string:
+      return json_escape(m_string);
+    case kind::boolean:
+      return m_boolean ? "true" : "false";
+    case kind::number:
+    default:
+      break;
+    }
+    if (std::isnan(m_number)) {
+      return "NaN";
+    }
+    if (std::isinf(m_number)) {
+      return m_number < 0 ? "-Infinity" : "Infinity";
+    }
+    return json_number(m_number);
+  }
+
+private:
+  kind m_kind;
+  std::string m_string;
+  double m_number{};
+  bool m_boolean{};
+};
+
+// Named arguments for a JS function.
+using js_args_t = std::map<std::string, js_arg>;
+
+// Creates JS code that calls a function with the given body and arguments.
+// This is the portable equivalent of passing the arguments separately from
+// the function body and is used when the backend can't do that.
+inline std::string create_js_function_call(const std::string &function_body,
+                                           const js_args_t &args) {
+  std::string names;
+  std::string values;
+  for (const auto &arg : args) {
+    if (!names.empty()) {
+      names += ", ";
+      values += ", ";
+    }
+    names += arg.first;
+    values += arg.second.to_js();
+  }
+  return "(function(" + names + ") {\n" + function_body + "\n})(" + values +
+         ")";
+}
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_JS_ARG_HH
@@ -30,6 +30,9 @@
 
 #include <cassert>
 #include <cstring>
+#include <iomanip>
+#include <locale>
+#include <sstream>
 #include <string>
 
 namespace webview {
@@ -327,6 +330,27 @@ inline std::string json_parse(const std::string &s, const std::string &key,
   return "";
 }
 
+// Formats a number for JS or JSON. Unlike printf(), this does not depend on
+// the C locale, which GTK sets from the environment.
+inline std::string json_number(double value, int precision = 17) {
+  std::ostringstream stream;
+  stream.imbue(std::locale::classic());
+  stream << std::setprecision(precision) << value;
+  return stream.str();
+}
+
+// Parses a number written by JS or JSON regardless of the C locale. Returns
+// the fallback if the string does not start with a number.
+inline double json_parse_number(const std::string &s, double fallback = 0) {
+  std::istringstream stream{s};
+  stream.imbue(std::locale::classic());
+  double value{};
+  if (!(stream >> value)) {
+    return fallback;
+  }
+  return value;
+}
+
 } // namespace detail
 } // namespace webview
 
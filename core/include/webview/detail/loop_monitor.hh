@@ -0,0 +1,143 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_LOOP_MONITOR_HH
+#define WEBVIEW_DETAIL_LOOP_MONITOR_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "histogram.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace webview {
+namespace detail {
+
+// Measures the iterations of the event loop while enabled: the time each
+// iteration spends dispatching sources, the share of that time that goes to
+// sources owned by the library such as dispatched functions and timers, and
+// the number of dispatched functions waiting to be called.
+//
+// Iterations are recorded by the backend and owned sources are marked with
+// owned_scope, all on the thread of the event loop. Snapshots can be taken
+// from any thread.
+class loop_monitor {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct snapshot {
+    std::uint64_t iterations{};
+    // Time spent dispatching per iteration in nanoseconds, excluding the time
+    // spent waiting for events.
+    histogram_snapshot busy_ns;
+    // Dispatched functions waiting to be called at the start of each
+    // iteration's dispatch phase.
+    histogram_snapshot pending_dispatches;
+    std::uint64_t total_busy_ns{};
+    std::uint64_t owned_busy_ns{};
+
+    // The share of busy time spent in sources owned by the library.
+    double owned_share() const {
+      return total_busy_ns ? static_cast<double>(owned_busy_ns) /
+                                 static_cast<double>(total_busy_ns)
+                           : 0;
+    }
+  };
+
+  // Attributes the time until destruction to sources owned by the library.
+  class owned_scope {
+  public:
+    explicit owned_scope(loop_monitor &monitor)
+        : m_monitor{monitor.is_enabled() ? &monitor : nullptr} {
+      // Only the outermost scope is measured.
+      if (m_monitor && m_monitor->m_owned_depth++ == 0) {
+        m_start = clock::now();
+      }
+    }
+
+    ~owned_scope() {
+      if (m_monitor && --m_monitor->m_owned_depth == 0) {
+        m_monitor->m_owned_busy_ns.fetch_add(to_ns(clock::now() - m_start),
+                                             std::memory_order_relaxed);
+      }
+    }
+
+    owned_scope(const owned_scope &) = delete;
+    owned_scope &operator=(const owned_scope &) = delete;
+
+  private:
+    loop_monitor *m_monitor;
+    clock::time_point m_start;
+  };
+
+  bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+  void set_enabled(bool enabled) {
+    m_enabled.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Records an iteration that spent the given time dispatching sources.
+  void record_iteration(clock::duration busy, std::uint64_t pending) {
+    auto busy_ns = to_ns(busy);
+    m_busy_ns.record(busy_ns);
+    m_pending_dispatches.record(pending);
+    m_total_busy_ns.fetch_add(busy_ns, std::memory_order_relaxed);
+    m_iterations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  snapshot get_snapshot() const {
+    snapshot s;
+    s.iterations = m_iterations.load(std::memory_order_relaxed);
+    s.busy_ns = m_busy_ns.snapshot();
+    s.pending_dispatches = m_pending_dispatches.snapshot();
+    s.total_busy_ns = m_total_busy_ns.load(std::memory_order_relaxed);
+    s.owned_busy_ns = m_owned_busy_ns.load(std::memory_order_relaxed);
+    return s;
+  }
+
+  static std::uint64_t to_ns(clock::duration duration) {
+    auto ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    return ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
+  }
+
+private:
+  std::atomic<bool> m_enabled{};
+  std::atomic<std::uint64_t> m_iterations{};
+  std::atomic<std::uint64_t> m_total_busy_ns{};
+  std::atomic<std::uint64_t> m_owned_busy_ns{};
+  latency_histogram m_busy_ns;
+  latency_histogram m_pending_dispatches;
+  // Only used on the thread of the event loop.
+  unsigned int m_owned_depth{};
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_LOOP_MONITOR_HH
@@ -0,0 +1,247 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_MAPPED_FILE_HH
+#define WEBVIEW_DETAIL_MAPPED_FILE_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "../errors.hh"
+#include "../types.hh"
+#include "buffer.hh"
+#include "utility/string.hh"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace webview {
+namespace detail {
+
+// Maps a file into memory for reading. The mapping is released when the last
+// buffer referring to it has been destroyed. The file must not be truncated
+// while mapped, since reading the pages past its new end crashes the process
+// (SIGBUS). Use read_file() for files that other processes may modify.
+inline result<buffer> map_file(const std::string &path) {
+#ifdef _WIN32
+  auto file = CreateFileW(widen_string(path).c_str(), GENERIC_READ,
+                          FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to open " + path};
+  }
+  LARGE_INTEGER file_size{};
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to stat " + path};
+  }
+  auto size = static_cast<std::size_t>(file_size.QuadPart);
+  if (size == 0) {
+    CloseHandle(file);
+    return buffer{};
+  }
+  auto mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to map " + path};
+  }
+  auto *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!data) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to map " + path};
+  }
+  std::shared_ptr<const void> owner{data, [](const void *p) {
+                                      UnmapViewOfFile(p);
+                                    }};
+#else
+  auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to open " + path};
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to stat " + path};
+  }
+  auto size = static_cast<std::size_t>(st.st_size);
+  if (size == 0) {
+    close(fd);
+    return buffer{};
+  }
+  auto *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to map " + path};
+  }
+  std::shared_ptr<const void> owner{data, [size](const void *p) {
+                                      munmap(const_cast<void *>(p), size);
+                                    }};
+#endif
+  return buffer{data, size, std::move(owner)};
+}
+
+// Reads part of a file into memory. Fails if the file has fewer bytes than
+// requested, e.g. because it has been truncated in the meantime.
+inline result<buffer> read_file(const std::string &path, std::uint64_t offset,
+                                std::size_t length) {
+  std::string data(length, '\0');
+  std::size_t done = 0;
+#ifdef _WIN32
+  auto file = CreateFileW(widen_string(path).c_str(), GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                          OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to open " + path};
+  }
+  LARGE_INTEGER position{};
+  position.QuadPart = static_cast<LONGLONG>(offset);
+  if (!SetFilePointerEx(file, position, nullptr, FILE_BEGIN)) {
+    CloseHandle(file);
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to seek " + path};
+  }
+  while (done < length) {
+    auto chunk = static_cast<DWORD>(
+        length - done < 0x40000000 ? length - done : 0x40000000);
+    DWORD count{};
+    if (!ReadFile(file, &data[done], chunk, &count, nullptr) || count == 0) {
+      break;
+    }
+    done += count;
+  }
+  CloseHandle(file);
+#else
+  auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to open " + path};
+  }
+  while (done < length) {
+    auto count = pread(fd, &data[done], length - done,
+                       static_cast<off_t>(offset + done));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    done += static_cast<std::size_t>(count);
+  }
+  close(fd);
+#endif
+  if (done != length) {
+    return error_info{WEBVIEW_ERROR_UNSPECIFIED, "Unable to read " + path};
+  }
+  return buffer{std::move(data)};
+}
+
+// Resolves symbolic links and relative components of the path to an existing
+// file or directory.
+inline bool get_canonical_path(const std::string &path, std::string &out) {
+#ifdef _WIN32
+  // Directories can only be opened with backup semantics.
+  auto file = CreateFileW(widen_string(path).c_str(), 0,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE |
+                              FILE_SHARE_DELETE,
+                          nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS,
+                          nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  std::wstring final_path(MAX_PATH, L'\0');
+  auto size = GetFinalPathNameByHandleW(
+      file, &final_path[0], static_cast<DWORD>(final_path.size()),
+      FILE_NAME_NORMALIZED);
+  if (size >= final_path.size()) {
+    final_path.resize(size);
+    size = GetFinalPathNameByHandleW(file, &final_path[0],
+                                     static_cast<DWORD>(final_path.size()),
+                                     FILE_NAME_NORMALIZED);
+  }
+  CloseHandle(file);
+  if (size == 0 || size >= final_path.size()) {
+    return false;
+  }
+  final_path.resize(size);
+  out = narrow_string(final_path);
+#else
+  std::unique_ptr<char, void (*)(void *)> resolved{
+      realpath(path.c_str(), nullptr), std::free};
+  if (!resolved) {
+    return false;
+  }
+  out = resolved.get();
+#endif
+  return true;
+}
+
+// Gets the size and last modification time (seconds since the Unix epoch) of
+// a regular file.
+inline bool get_file_info(const std::string &path, std::uint64_t &size,
+                          std::int64_t &modified) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data{};
+  if (!GetFileAttributesExW(widen_string(path).c_str(), GetFileExInfoStandard,
+                            &data) ||
+      (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    return false;
+  }
+  size = static_cast<std::uint64_t>(data.nFileSizeHigh) << 32 |
+         data.nFileSizeLow;
+  // FILETIME counts 100-nanosecond intervals since 1601-01-01
+  auto time = static_cast<std::int64_t>(
+      static_cast<std::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32 |
+      data.ftLastWriteTime.dwLowDateTime);
+  modified = time / 10000000 - 11644473600LL;
+#else
+  struct stat st {};
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+  size = static_cast<std::uint64_t>(st.st_size);
+  modified = static_cast<std::int64_t>(st.st_mtime);
+#endif
+  return true;
+}
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_MAPPED_FILE_HH
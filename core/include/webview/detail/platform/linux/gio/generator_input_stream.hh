@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_PLATFORM_LINUX_GIO_GENERATOR_INPUT_STREAM_HH
+#define WEBVIEW_PLATFORM_LINUX_GIO_GENERATOR_INPUT_STREAM_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "../../../../macros.h"
+
+#if defined(WEBVIEW_PLATFORM_LINUX) && defined(WEBVIEW_GTK)
+
+#include "../../../scheme.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <gio/gio.h>
+
+namespace webview {
+namespace detail {
+
+// A GInputStream that reads the chunks produced by a generator as they are
+// needed. GIO may call the generator from a worker thread when the stream
+// is read asynchronously, but never concurrently.
+class generator_input_stream {
+public:
+  static GInputStream *create(body_generator_t generator) {
+    auto *stream = static_cast<instance *>(g_object_new(get_type(), nullptr));
+    stream->data = new state{std::move(generator)};
+    return G_INPUT_STREAM(stream);
+  }
+
+private:
+  struct state {
+    explicit state(body_generator_t generator)
+        : generator{std::move(generator)} {}
+    body_generator_t generator;
+    std::string chunk;
+    std::size_t offset{};
+    bool done{};
+  };
+
+  struct instance {
+    GInputStream parent_instance;
+    state *data;
+  };
+
+  static GType get_type() {
+    static GType type = g_type_register_static_simple(
+        G_TYPE_INPUT_STREAM, "WebviewGeneratorInputStream",
+        sizeof(GInputStreamClass), class_init, sizeof(instance), nullptr,
+        static_cast<GTypeFlags>(0));
+    return type;
+  }
+
+  static GObjectClass *&parent_class() {
+    static GObjectClass *parent{};
+    return parent;
+  }
+
+  static void class_init(gpointer klass, gpointer /*data*/) {
+    parent_class() = G_OBJECT_CLASS(g_type_class_peek_parent(klass));
+    G_OBJECT_CLASS(klass)->finalize = finalize;
+    G_INPUT_STREAM_CLASS(klass)->read_fn = read;
+  }
+
+  static void finalize(GObject *object) {
+    delete reinterpret_cast<instance *>(object)->data;
+    parent_class()->finalize(object);
+  }
+
+  static gssize read(GInputStream *stream, void *buffer, gsize count,
+                     GCancellable * /*cancellable*/, GError **error) {
+    auto &s = *reinterpret_cast<instance *>(stream)->data;
+    try {
+      while (s.offset == s.chunk.size()) {
+        if (s.done) {
+          return 0;
+        }
+        s.chunk.clear();
+        s.offset = 0;
+        s.done = !s.generator(s.chunk);
+      }
+    } catch (...) {
+      s.done = true;
+      s.chunk.clear();
+      s.offset = 0;
+      g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                          "Generator failed");
+      return -1;
+    }
+    auto n = std::min<std::size_t>(count, s.chunk.size() - s.offset);
+    std::memcpy(buffer, s.chunk.data() + s.offset, n);
+    s.offset += n;
+    return static_cast<gssize>(n);
+  }
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(WEBVIEW_PLATFORM_LINUX) && defined(WEBVIEW_GTK)
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_PLATFORM_LINUX_GIO_GENERATOR_INPUT_STREAM_HH
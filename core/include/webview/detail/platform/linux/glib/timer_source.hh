@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_PLATFORM_LINUX_GLIB_TIMER_SOURCE_HH
+#define WEBVIEW_PLATFORM_LINUX_GLIB_TIMER_SOURCE_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "../../../../macros.h"
+
+#if defined(WEBVIEW_PLATFORM_LINUX) && defined(WEBVIEW_GTK)
+
+#include <functional>
+#include <utility>
+
+#include <glib.h>
+
+namespace webview {
+namespace detail {
+
+// A GSource that calls a function once or repeatedly after an interval.
+//
+// Unlike g_timeout_source_new(), deadlines are rounded up to a grid whose
+// spacing is a power of two milliseconds proportional to the interval (timer
+// slack). Since the grids of different timers nest, timers that expire around
+// the same time wake up the loop together instead of one after another.
+class timer_source {
+public:
+  static GSource *create(unsigned int interval_ms, bool repeat,
+                         std::function<void()> fn) {
+    static GSourceFuncs funcs{nullptr, nullptr, dispatch, finalize,
+                              nullptr, nullptr};
+    auto *source = g_source_new(&funcs, sizeof(instance));
+    auto *data = new state{std::move(fn)};
+    data->interval = static_cast<gint64>(interval_ms) * 1000;
+    data->slack = slack_for(data->interval);
+    data->repeat = repeat;
+    data->deadline = g_get_monotonic_time() + data->interval;
+    reinterpret_cast<instance *>(source)->data = data;
+    g_source_set_name(source, "webview timer");
+    schedule(source, *data);
+    return source;
+  }
+
+  // Returns the timer slack in microseconds for an interval in microseconds.
+  static gint64 slack_for(gint64 interval) {
+    static const gint64 max_slack = 64 * 1000;
+    gint64 slack = 1000;
+    while (slack * 2 <= interval / 16 && slack < max_slack) {
+      slack *= 2;
+    }
+    return slack;
+  }
+
+private:
+  struct state {
+    explicit state(std::function<void()> fn) : fn{std::move(fn)} {}
+    std::function<void()> fn;
+    gint64 interval{};
+    gint64 slack{};
+    gint64 deadline{};
+    bool repeat{};
+  };
+
+  struct instance {
+    GSource source;
+    state *data;
+  };
+
+  static void schedule(GSource *source, const state &s) {
+    auto ready_time = (s.deadline + s.slack - 1) / s.slack * s.slack;
+    g_source_set_ready_time(source, ready_time);
+  }
+
+  static gboolean dispatch(GSource *source, GSourceFunc /*callback*/,
+                           gpointer /*user_data*/) {
+    auto &s = *reinterpret_cast<instance *>(source)->data;
+    if (!s.repeat) {
+      s.fn();
+      return G_SOURCE_REMOVE;
+    }
+    // Keep the cadence of the timer unless it has fallen behind.
+    auto now = g_get_monotonic_time();
+    s.deadline += s.interval;
+    if (s.deadline < now) {
+      s.deadline = now + s.interval;
+    }
+    schedule(source, s);
+    s.fn();
+    return G_SOURCE_CONTINUE;
+  }
+
+  static void finalize(GSource *source) {
+    delete reinterpret_cast<instance *>(source)->data;
+  }
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(WEBVIEW_PLATFORM_LINUX) && defined(WEBVIEW_GTK)
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_PLATFORM_LINUX_GLIB_TIMER_SOURCE_HH
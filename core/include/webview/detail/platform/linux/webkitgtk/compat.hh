@@ -95,6 +95,42 @@ public:
                           static_cast<GConnectFlags>(0) /*G_CONNECT_DEFAULT*/);
   }
 
+#if GTK_MAJOR_VERSION >= 4 ||                                                  \
+    (WEBKIT_MAJOR_VERSION == 2 && WEBKIT_MINOR_VERSION >= 22) ||               \
+    WEBKIT_MAJOR_VERSION > 2
+  using on_script_message_value_received_t =
+      std::function<void(WebKitUserContentManager *, JSCValue *)>;
+  static void connect_script_message_value_received(
+      WebKitUserContentManager *manager, const std::string &handler_name,
+      on_script_message_value_received_t handler) {
+    std::string signal_name = "script-message-received::";
+    signal_name += handler_name;
+
+    auto callback = +[](WebKitUserContentManager *manager,
+                        wk_handler_js_value_t *r, gpointer arg) {
+      auto *handler = static_cast<on_script_message_value_received_t *>(arg);
+      (*handler)(manager, get_js_value_from_js_result(r));
+    };
+
+    auto deleter = +[](gpointer data, GClosure *) {
+      delete static_cast<on_script_message_value_received_t *>(data);
+    };
+
+    g_signal_connect_data(manager, signal_name.c_str(), G_CALLBACK(callback),
+                          new on_script_message_value_received_t{handler},
+                          deleter,
+                          static_cast<GConnectFlags>(0) /*G_CONNECT_DEFAULT*/);
+  }
+
+  static JSCValue *get_js_value_from_js_result(JSCValue *r) { return r; }
+
+#if GTK_MAJOR_VERSION < 4
+  static JSCValue *get_js_value_from_js_result(WebKitJavascriptResult *r) {
+    return webkit_javascript_result_get_js_value(r);
+  }
+#endif
+#endif
+
   static std::string get_string_from_js_result(JSCValue *r) {
     char *cs = jsc_value_to_string(r);
     std::string s{cs};
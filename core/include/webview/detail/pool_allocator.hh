@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_POOL_ALLOCATOR_HH
+#define WEBVIEW_DETAIL_POOL_ALLOCATOR_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace webview {
+namespace detail {
+
+// A thread-safe free list of memory blocks of a fixed size. Released blocks
+// are kept for reuse up to a limit instead of being returned to the heap.
+template <std::size_t BlockSize, std::size_t MaxFree = 64> class block_pool {
+public:
+  static block_pool &instance() {
+    // Leaked on purpose so that blocks can be released during static
+    // destruction.
+    static auto *pool = new block_pool;
+    return *pool;
+  }
+
+  void *allocate() {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      if (m_free) {
+        auto *block = m_free;
+        m_free = block->next;
+        --m_free_count;
+        return block;
+      }
+    }
+    return ::operator new(block_size);
+  }
+
+  void deallocate(void *p) {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      if (m_free_count < MaxFree) {
+        auto *block = static_cast<free_block *>(p);
+        block->next = m_free;
+        m_free = block;
+        ++m_free_count;
+        return;
+      }
+    }
+    ::operator delete(p);
+  }
+
+  std::size_t free_count() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_free_count;
+  }
+
+private:
+  struct free_block {
+    free_block *next;
+  };
+
+  static constexpr std::size_t block_size =
+      BlockSize < sizeof(free_block) ? sizeof(free_block) : BlockSize;
+
+  block_pool() = default;
+
+  mutable std::mutex m_mutex;
+  free_block *m_free{};
+  std::size_t m_free_count{};
+};
+
+// An allocator that takes single objects from a block_pool for their size.
+// Arrays are allocated on the heap.
+template <typename T> class pool_allocator {
+public:
+  using value_type = T;
+
+  pool_allocator() noexcept = default;
+  template <typename U> pool_allocator(const pool_allocator<U> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    if (n == 1 && alignof(T) <= alignof(std::max_align_t)) {
+      return static_cast<T *>(pool().allocate());
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, std::size_t n) noexcept {
+    if (n == 1 && alignof(T) <= alignof(std::max_align_t)) {
+      pool().deallocate(p);
+      return;
+    }
+    ::operator delete(p);
+  }
+
+  static block_pool<sizeof(T)> &pool() {
+    return block_pool<sizeof(T)>::instance();
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const pool_allocator<T> &, const pool_allocator<U> &) noexcept {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const pool_allocator<T> &, const pool_allocator<U> &) noexcept {
+  return false;
+}
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_POOL_ALLOCATOR_HH
@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_PROBES_HH
+#define WEBVIEW_DETAIL_PROBES_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+// Static probes (USDT) at the points of the IPC path where calls enter and
+// leave the library, for use with tools such as bpftrace and perf. Probes are
+// compiled in when WEBVIEW_ENABLE_USDT is defined and <sys/sdt.h> is
+// available, in which case each probe is a single NOP until a tracer attaches
+// to it. Otherwise they expand to nothing.
+//
+// Provider "webview":
+//   on_message(id, method, params size)    a binding call was received
+//   binding_entry(id, method, params size) the binding handler is called
+//   binding_return(id, method)             the binding handler returned
+//   resolve(id, status, result size)       a call was resolved
+//   reply(id, status, result size)         the reply is about to be evaluated
+//   dispatch(priority)                     work was dispatched
+//   eval(script size)                      a script is about to be evaluated
+
+#if defined(WEBVIEW_ENABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define WEBVIEW_HAVE_USDT
+#endif
+#endif
+
+#ifdef WEBVIEW_HAVE_USDT
+#define WEBVIEW_PROBE1(name, a1) DTRACE_PROBE1(webview, name, a1)
+#define WEBVIEW_PROBE2(name, a1, a2) DTRACE_PROBE2(webview, name, a1, a2)
+#define WEBVIEW_PROBE3(name, a1, a2, a3)                                       \
+  DTRACE_PROBE3(webview, name, a1, a2, a3)
+#else
+#define WEBVIEW_PROBE1(name, a1) ((void)0)
+#define WEBVIEW_PROBE2(name, a1, a2) ((void)0)
+#define WEBVIEW_PROBE3(name, a1, a2, a3) ((void)0)
+#endif
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_PROBES_HH
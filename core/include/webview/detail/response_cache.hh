@@ -0,0 +1,239 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_RESPONSE_CACHE_HH
+#define WEBVIEW_DETAIL_RESPONSE_CACHE_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "scheme.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace webview {
+namespace detail {
+
+// An LRU cache of successful responses to GET requests on custom URI
+// schemes, keyed by URI. Responses are given validators if they don't have
+// any so that conditional requests can be answered with 304 Not Modified.
+// Streamed responses are passed through uncached.
+class response_cache {
+public:
+  struct stats {
+    std::uint64_t hits{};
+    std::uint64_t misses{};
+    std::uint64_t evictions{};
+    std::size_t entries{};
+    std::size_t size{};
+    std::size_t budget{};
+  };
+
+  // The budget is the maximum total size in bytes of the cached bodies.
+  explicit response_cache(std::size_t budget = 32 * 1024 * 1024)
+      : m_budget{budget} {}
+
+  response_cache(const response_cache &) = delete;
+  response_cache &operator=(const response_cache &) = delete;
+
+  // Wraps a handler so that its responses are served from the cache. The
+  // cache must outlive the returned handler.
+  scheme_handler_t wrap(scheme_handler_t handler) {
+    return [this, handler](const scheme_request &request) {
+      return handle(request, handler);
+    };
+  }
+
+  scheme_response handle(const scheme_request &request,
+                         const scheme_handler_t &handler) {
+    if (request.method != "GET" && request.method != "HEAD") {
+      return handler(request);
+    }
+    entry cached;
+    if (!lookup(request.uri, cached)) {
+      // Conditional and range requests are handled below on the full
+      // response.
+      auto full_request = request;
+      full_request.method = "GET";
+      full_request.headers.erase("Range");
+      full_request.headers.erase("If-None-Match");
+      full_request.headers.erase("If-Modified-Since");
+      auto response = handler(full_request);
+      if (response.status != 200) {
+        return response;
+      }
+      // Streamed bodies are only known once sent and cannot be cached. The
+      // full response is a valid answer to range and conditional requests.
+      if (response.body_generator) {
+        if (request.method == "HEAD") {
+          response.body_generator = nullptr;
+        }
+        return response;
+      }
+      cached = make_entry(std::move(response));
+      insert(request.uri, cached);
+    }
+    auto response = make_resource_response(
+        request, cached.response.body, cached.response.content_type,
+        cached.response.content_encoding, cached.etag, cached.last_modified);
+    for (const auto &header : cached.response.headers) {
+      response.headers.insert(header);
+    }
+    return response;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_lru.clear();
+    m_index.clear();
+    m_size = 0;
+  }
+
+  void set_budget(std::size_t budget) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_budget = budget;
+    evict();
+  }
+
+  stats get_stats() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    stats s;
+    s.hits = m_hits;
+    s.misses = m_misses;
+    s.evictions = m_evictions;
+    s.entries = m_index.size();
+    s.size = m_size;
+    s.budget = m_budget;
+    return s;
+  }
+
+private:
+  struct entry {
+    scheme_response response;
+    std::string etag;
+    std::string last_modified;
+  };
+  using lru_list = std::list<std::pair<std::string, entry>>;
+
+  static entry make_entry(scheme_response response) {
+    entry e;
+    auto etag = response.headers.find("ETag");
+    if (etag != response.headers.end()) {
+      e.etag = etag->second;
+      response.headers.erase(etag);
+    } else {
+      e.etag = hash_etag(response.body);
+    }
+    auto last_modified = response.headers.find("Last-Modified");
+    if (last_modified != response.headers.end()) {
+      e.last_modified = last_modified->second;
+      response.headers.erase(last_modified);
+    } else {
+      auto now = std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch());
+      e.last_modified = format_http_date(now.count());
+    }
+    // Make the browser revalidate instead of using heuristic freshness.
+    response.headers.insert({"Cache-Control", "no-cache"});
+    e.response = std::move(response);
+    return e;
+  }
+
+  // FNV-1a hash of the content
+  static std::string hash_etag(const buffer &body) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::size_t i = 0; i < body.size(); ++i) {
+      hash = (hash ^ body.data()[i]) * 0x100000001b3ULL;
+    }
+    char etag[20];
+    std::snprintf(etag, sizeof(etag), "\"%016llx\"",
+                  static_cast<unsigned long long>(hash));
+    return etag;
+  }
+
+  bool lookup(const std::string &uri, entry &out) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto found = m_index.find(uri);
+    if (found == m_index.end()) {
+      ++m_misses;
+      return false;
+    }
+    ++m_hits;
+    m_lru.splice(m_lru.begin(), m_lru, found->second);
+    out = found->second->second;
+    return true;
+  }
+
+  void insert(const std::string &uri, const entry &e) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    auto size = e.response.body.size();
+    if (size > m_budget) {
+      return;
+    }
+    auto found = m_index.find(uri);
+    if (found != m_index.end()) {
+      m_size -= found->second->second.response.body.size();
+      m_lru.erase(found->second);
+      m_index.erase(found);
+    }
+    m_lru.emplace_front(uri, e);
+    m_index.emplace(uri, m_lru.begin());
+    m_size += size;
+    evict();
+  }
+
+  void evict() {
+    while (m_size > m_budget && !m_lru.empty()) {
+      auto &last = m_lru.back();
+      m_size -= last.second.response.body.size();
+      m_index.erase(last.first);
+      m_lru.pop_back();
+      ++m_evictions;
+    }
+  }
+
+  mutable std::mutex m_mutex;
+  lru_list m_lru;
+  std::unordered_map<std::string, lru_list::iterator> m_index;
+  std::size_t m_size{};
+  std::size_t m_budget;
+  std::uint64_t m_hits{};
+  std::uint64_t m_misses{};
+  std::uint64_t m_evictions{};
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_RESPONSE_CACHE_HH
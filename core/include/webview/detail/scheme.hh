@@ -0,0 +1,405 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_SCHEME_HH
+#define WEBVIEW_DETAIL_SCHEME_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "buffer.hh"
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace webview {
+namespace detail {
+
+// Orders header names case-insensitively.
+struct header_name_less {
+  bool operator()(const std::string &a, const std::string &b) const {
+    auto n = a.size() < b.size() ? a.size() : b.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      auto ca = std::tolower(static_cast<unsigned char>(a[i]));
+      auto cb = std::tolower(static_cast<unsigned char>(b[i]));
+      if (ca != cb) {
+        return ca < cb;
+      }
+    }
+    return a.size() < b.size();
+  }
+};
+
+using scheme_headers_t = std::map<std::string, std::string, header_name_less>;
+
+// A request for a resource on a custom URI scheme.
+struct scheme_request {
+  std::string scheme;
+  std::string method{"GET"};
+  std::string uri;
+  // The path component of the URI without the query string.
+  std::string path;
+  scheme_headers_t headers;
+  buffer body;
+};
+
+// Produces the next chunk of a body in the given string, which is empty when
+// called. Returns false if there are no more chunks after this one.
+using body_generator_t = std::function<bool(std::string &chunk)>;
+
+// The response to a request on a custom URI scheme. The body is passed to the
+// browser engine without copying when supported by the backend.
+struct scheme_response {
+  int status{200};
+  std::string content_type{"application/octet-stream"};
+  // Set to "gzip" if the body is compressed, in which case the backend
+  // decompresses it while it is being read.
+  std::string content_encoding;
+  scheme_headers_t headers;
+  buffer body;
+  // When set, the body is produced by the generator while it is being read
+  // instead of being taken from the buffer.
+  body_generator_t body_generator;
+};
+
+using scheme_handler_t =
+    std::function<scheme_response(const scheme_request &request)>;
+
+// Guesses the MIME type of a resource from the extension of its path.
+inline std::string guess_mime_type(const std::string &path) {
+  static const std::map<std::string, std::string> mime_types{
+      {"css", "text/css"},
+      {"gif", "image/gif"},
+      {"htm", "text/html"},
+      {"html", "text/html"},
+      {"ico", "image/x-icon"},
+      {"jpeg", "image/jpeg"},
+      {"jpg", "image/jpeg"},
+      {"js", "text/javascript"},
+      {"json", "application/json"},
+      {"m4a", "audio/mp4"},
+      {"map", "application/json"},
+      {"mjs", "text/javascript"},
+      {"mp3", "audio/mpeg"},
+      {"mp4", "video/mp4"},
+      {"ogg", "audio/ogg"},
+      {"otf", "font/otf"},
+      {"pdf", "application/pdf"},
+      {"png", "image/png"},
+      {"svg", "image/svg+xml"},
+      {"ttf", "font/ttf"},
+      {"txt", "text/plain"},
+      {"wasm", "application/wasm"},
+      {"wav", "audio/wav"},
+      {"webm", "video/webm"},
+      {"webp", "image/webp"},
+      {"woff", "font/woff"},
+      {"woff2", "font/woff2"},
+      {"xml", "application/xml"}};
+  auto dot = path.find_last_of("./");
+  if (dot != std::string::npos && path[dot] == '.') {
+    auto extension = path.substr(dot + 1);
+    for (auto &c : extension) {
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    auto found = mime_types.find(extension);
+    if (found != mime_types.end()) {
+      return found->second;
+    }
+  }
+  return "application/octet-stream";
+}
+
+// Decodes percent-encoded characters in a URI component. Returns false if
+// the input is malformed.
+inline bool percent_decode(const std::string &input, std::string &output) {
+  output.clear();
+  output.reserve(input.size());
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    if (input[i] != '%') {
+      output += input[i];
+      continue;
+    }
+    auto digits = input.substr(i + 1, 2);
+    if (digits.size() != 2 ||
+        digits.find_first_not_of("0123456789abcdefABCDEF") !=
+            std::string::npos) {
+      return false;
+    }
+    output += static_cast<char>(std::stoi(digits, nullptr, 16));
+    i += 2;
+  }
+  return true;
+}
+
+// Parses the value of a Range header with a single byte range, e.g.
+// "bytes=0-499", "bytes=500-" or "bytes=-500", for content of the given size.
+// Returns false if the range is invalid or cannot be satisfied.
+inline bool parse_byte_range(const std::string &header, std::uint64_t size,
+                             std::uint64_t &offset, std::uint64_t &length) {
+  static const std::string prefix{"bytes="};
+  if (header.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  auto spec = header.substr(prefix.size());
+  auto dash = spec.find('-');
+  if (dash == std::string::npos ||
+      spec.find_first_not_of("0123456789-") != std::string::npos ||
+      spec.find('-', dash + 1) != std::string::npos) {
+    return false;
+  }
+  auto first = spec.substr(0, dash);
+  auto last = spec.substr(dash + 1);
+  if (first.empty() && last.empty()) {
+    return false;
+  }
+  try {
+    if (first.empty()) {
+      // Suffix range, i.e. the last N bytes
+      auto n = std::stoull(last);
+      if (n == 0 || size == 0) {
+        return false;
+      }
+      length = n < size ? n : size;
+      offset = size - length;
+      return true;
+    }
+    auto begin = std::stoull(first);
+    if (begin >= size) {
+      return false;
+    }
+    std::uint64_t end = size - 1;
+    if (!last.empty()) {
+      end = std::stoull(last);
+      if (end < begin) {
+        return false;
+      }
+      if (end >= size) {
+        end = size - 1;
+      }
+    }
+    offset = begin;
+    length = end - begin + 1;
+    return true;
+  } catch (const std::out_of_range &) {
+    return false;
+  }
+}
+
+// Formats a time given in seconds since the Unix epoch as an HTTP date, e.g.
+// "Sun, 06 Nov 1994 08:49:37 GMT".
+inline std::string format_http_date(std::int64_t seconds) {
+  auto time = static_cast<std::time_t>(seconds);
+  std::tm tm{};
+#ifdef _WIN32
+  gmtime_s(&tm, &time);
+#else
+  gmtime_r(&time, &tm);
+#endif
+  char date[32];
+  std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  return date;
+}
+
+// Checks the conditional headers of a request against the validators of a
+// resource. Dates are compared as strings since browsers send back the value
+// of Last-Modified as is.
+inline bool is_not_modified(const scheme_request &request,
+                            const std::string &etag,
+                            const std::string &last_modified) {
+  auto if_none_match = request.headers.find("If-None-Match");
+  if (if_none_match != request.headers.end()) {
+    if (etag.empty()) {
+      return false;
+    }
+    const auto &tags = if_none_match->second;
+    std::size_t begin = 0;
+    while (begin < tags.size()) {
+      auto end = tags.find(',', begin);
+      if (end == std::string::npos) {
+        end = tags.size();
+      }
+      auto first = tags.find_first_not_of(" \t", begin);
+      auto last = tags.find_last_not_of(" \t", end - 1);
+      if (first < end && last != std::string::npos && last >= first) {
+        auto tag = tags.substr(first, last - first + 1);
+        // Weak comparison
+        if (tag.compare(0, 2, "W/") == 0) {
+          tag.erase(0, 2);
+        }
+        if (tag == "*" || tag == etag) {
+          return true;
+        }
+      }
+      begin = end + 1;
+    }
+    return false;
+  }
+  auto if_modified_since = request.headers.find("If-Modified-Since");
+  return if_modified_since != request.headers.end() &&
+         !last_modified.empty() && if_modified_since->second == last_modified;
+}
+
+// Reads part of the content of a resource. Returns false on failure.
+using content_reader_t =
+    std::function<bool(std::uint64_t offset, std::size_t length, buffer &out)>;
+
+// Bodies read with a content_reader_t that are larger than this are streamed
+// in chunks of this size instead of being read into memory at once.
+const std::size_t resource_chunk_size = 64 * 1024;
+
+// Open-ended range requests, e.g. "bytes=0-", are answered with at most this
+// many bytes. Media elements request the rest as they play.
+const std::uint64_t max_open_range_size = 8 * 1024 * 1024;
+
+// Sets up a response for a static resource of the given size. Returns true
+// if the body must still be set to the given part of the content.
+inline bool begin_resource_response(const scheme_request &request,
+                                    std::uint64_t size,
+                                    scheme_response &response,
+                                    std::uint64_t &offset,
+                                    std::uint64_t &length,
+                                    const std::string &content_encoding,
+                                    const std::string &etag,
+                                    const std::string &last_modified) {
+  if (request.method != "GET" && request.method != "HEAD") {
+    response.status = 405;
+    response.headers["Allow"] = "GET, HEAD";
+    return false;
+  }
+  if (!etag.empty()) {
+    response.headers["ETag"] = etag;
+  }
+  if (!last_modified.empty()) {
+    response.headers["Last-Modified"] = last_modified;
+  }
+  if (is_not_modified(request, etag, last_modified)) {
+    response.status = 304;
+    return false;
+  }
+  response.content_encoding = content_encoding;
+  offset = 0;
+  length = size;
+  if (content_encoding.empty()) {
+    response.headers["Accept-Ranges"] = "bytes";
+    auto range = request.headers.find("Range");
+    if (range != request.headers.end()) {
+      auto total = std::to_string(size);
+      if (!parse_byte_range(range->second, size, offset, length)) {
+        response.status = 416;
+        response.headers["Content-Range"] = "bytes */" + total;
+        return false;
+      }
+      if (range->second.back() == '-' && length > max_open_range_size) {
+        length = max_open_range_size;
+      }
+      response.status = 206;
+      response.headers["Content-Range"] =
+          "bytes " + std::to_string(offset) + "-" +
+          std::to_string(offset + length - 1) + "/" + total;
+    }
+  }
+  return request.method == "GET";
+}
+
+// Creates a response for a static resource of the given size, handling HEAD
+// requests, conditional requests when validators are given, and range
+// requests when the content is not encoded. Only the part of the content
+// that ends up in the response is read, and large bodies are read chunk by
+// chunk while the response is being sent.
+inline scheme_response
+make_resource_response(const scheme_request &request, std::uint64_t size,
+                       const content_reader_t &read,
+                       const std::string &content_type,
+                       const std::string &content_encoding = {},
+                       const std::string &etag = {},
+                       const std::string &last_modified = {}) {
+  scheme_response response;
+  response.content_type = content_type;
+  std::uint64_t offset{};
+  std::uint64_t length{};
+  if (!begin_resource_response(request, size, response, offset, length,
+                               content_encoding, etag, last_modified)) {
+    return response;
+  }
+  if (length > resource_chunk_size) {
+    // Errors after the headers have been sent can only end the body early.
+    response.body_generator = [read, offset, length](
+                                  std::string &chunk) mutable {
+      auto n = static_cast<std::size_t>(
+          length < resource_chunk_size ? length : resource_chunk_size);
+      buffer data;
+      if (!read(offset, n, data) || data.size() != n) {
+        return false;
+      }
+      chunk.assign(reinterpret_cast<const char *>(data.data()), n);
+      offset += n;
+      length -= n;
+      return length > 0;
+    };
+    return response;
+  }
+  if (!read(offset, static_cast<std::size_t>(length), response.body)) {
+    scheme_response error;
+    error.status = 500;
+    return error;
+  }
+  return response;
+}
+
+// Creates a response for a static resource that is already in memory.
+inline scheme_response
+make_resource_response(const scheme_request &request, buffer content,
+                       const std::string &content_type,
+                       const std::string &content_encoding = {},
+                       const std::string &etag = {},
+                       const std::string &last_modified = {}) {
+  scheme_response response;
+  response.content_type = content_type;
+  std::uint64_t offset{};
+  std::uint64_t length{};
+  if (!begin_resource_response(request, content.size(), response, offset,
+                               length, content_encoding, etag,
+                               last_modified)) {
+    return response;
+  }
+  response.body = offset == 0 && length == content.size()
+                      ? std::move(content)
+                      : content.slice(static_cast<std::size_t>(offset),
+                                      static_cast<std::size_t>(length));
+  return response;
+}
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_SCHEME_HH
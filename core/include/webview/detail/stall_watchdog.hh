@@ -0,0 +1,267 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_STALL_WATCHDOG_HH
+#define WEBVIEW_DETAIL_STALL_WATCHDOG_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace webview {
+namespace detail {
+
+// Watches the thread of the event loop for work that blocks it for longer
+// than a threshold.
+//
+// Dispatched functions and binding handlers are marked with task_scope so
+// that stalls can be attributed to them. A watchdog thread checks the running
+// task and also posts heartbeats to the loop in order to notice stalls in
+// other sources, which are reported with the site "event loop".
+class stall_watchdog {
+public:
+  using clock = std::chrono::steady_clock;
+
+  // Called on the watchdog thread with the site of a stall and how long it
+  // has lasted: once when the stall is noticed while still ongoing, and once
+  // with finished set when it has ended.
+  using callback_t =
+      std::function<void(const std::string &site,
+                         std::chrono::milliseconds duration, bool finished)>;
+
+  // Posts a function to the event loop.
+  using post_fn_t = std::function<void(std::function<void()>)>;
+
+  struct stats {
+    std::uint64_t count{};
+    std::uint64_t total_us{};
+    std::uint64_t max_us{};
+    // Number of stalls per site.
+    std::map<std::string, std::uint64_t> sites;
+  };
+
+  // Marks a task on the thread of the event loop. Nested scopes refine the
+  // site of the outermost one, e.g. a binding handler within a dispatched
+  // function.
+  class task_scope {
+  public:
+    task_scope(stall_watchdog &watchdog, const char *kind, const char *name)
+        : m_watchdog{watchdog.is_enabled() ? &watchdog : nullptr} {
+      if (m_watchdog) {
+        m_watchdog->begin_task(std::string{kind} + ' ' + name);
+      }
+    }
+
+    ~task_scope() {
+      if (m_watchdog) {
+        m_watchdog->end_task();
+      }
+    }
+
+    task_scope(const task_scope &) = delete;
+    task_scope &operator=(const task_scope &) = delete;
+
+  private:
+    stall_watchdog *m_watchdog;
+  };
+
+  stall_watchdog() = default;
+  ~stall_watchdog() { stop(); }
+
+  stall_watchdog(const stall_watchdog &) = delete;
+  stall_watchdog &operator=(const stall_watchdog &) = delete;
+
+  bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+  void start(std::chrono::milliseconds threshold, post_fn_t post,
+             callback_t callback) {
+    stop();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_threshold = threshold;
+    m_post = std::move(post);
+    m_callback = std::move(callback);
+    m_is_stopping = false;
+    m_enabled.store(true, std::memory_order_relaxed);
+    m_thread = std::thread{[this] { watch(); }};
+  }
+
+  // Stops the watchdog thread. Nothing is posted to the loop once this has
+  // returned.
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      if (!m_thread.joinable()) {
+        return;
+      }
+      m_is_stopping = true;
+      m_enabled.store(false, std::memory_order_relaxed);
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_post = nullptr;
+    m_callback = nullptr;
+  }
+
+  stats get_stats() const {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats;
+  }
+
+private:
+  struct heartbeat {
+    clock::time_point posted;
+    std::atomic<bool> received{};
+    // Only read after received has been set.
+    clock::time_point received_at;
+  };
+
+  struct report {
+    std::string site;
+    clock::duration duration;
+    bool finished;
+  };
+
+  void begin_task(std::string site) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (m_task_depth++ == 0) {
+      m_task_start = clock::now();
+      m_is_task_reported = false;
+    }
+    m_task_site = std::move(site);
+  }
+
+  void end_task() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (m_task_depth == 0 || --m_task_depth > 0) {
+      return;
+    }
+    auto duration = clock::now() - m_task_start;
+    if (duration >= m_threshold) {
+      record_stall(m_task_site, duration);
+      m_reports.push_back({m_task_site, duration, true});
+    }
+  }
+
+  void record_stall(const std::string &site, clock::duration duration) {
+    auto us = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(duration)
+            .count());
+    ++m_stats.count;
+    m_stats.total_us += us;
+    m_stats.max_us = std::max(m_stats.max_us, us);
+    ++m_stats.sites[site];
+  }
+
+  void watch() {
+    static const char *loop_site = "event loop";
+    std::unique_lock<std::mutex> lock{m_mutex};
+    auto interval = std::max(m_threshold / 4, std::chrono::milliseconds{1});
+    std::shared_ptr<heartbeat> beat;
+    bool is_beat_reported{};
+    while (!m_cv.wait_for(lock, interval, [this] { return m_is_stopping; })) {
+      auto now = clock::now();
+      std::vector<report> reports;
+      reports.swap(m_reports);
+      if (m_task_depth > 0 && !m_is_task_reported &&
+          now - m_task_start >= m_threshold) {
+        m_is_task_reported = true;
+        reports.push_back({m_task_site, now - m_task_start, false});
+      }
+      if (beat && beat->received.load(std::memory_order_acquire)) {
+        if (is_beat_reported) {
+          auto duration = beat->received_at - beat->posted;
+          record_stall(loop_site, duration);
+          reports.push_back({loop_site, duration, true});
+        }
+        beat.reset();
+      } else if (beat && !is_beat_reported && m_task_depth == 0 &&
+                 now - beat->posted >= m_threshold) {
+        // Stalls within tasks are attributed to the tasks instead.
+        is_beat_reported = true;
+        reports.push_back({loop_site, now - beat->posted, false});
+      }
+      std::shared_ptr<heartbeat> new_beat;
+      if (!beat) {
+        new_beat = std::make_shared<heartbeat>();
+        new_beat->posted = now;
+        beat = new_beat;
+        is_beat_reported = false;
+      }
+      // The post function and callback are only replaced while this thread
+      // isn't running.
+      lock.unlock();
+      if (new_beat) {
+        m_post([new_beat] {
+          new_beat->received_at = clock::now();
+          new_beat->received.store(true, std::memory_order_release);
+        });
+      }
+      if (m_callback) {
+        for (const auto &r : reports) {
+          m_callback(r.site,
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                         r.duration),
+                     r.finished);
+        }
+      }
+      lock.lock();
+    }
+  }
+
+  std::atomic<bool> m_enabled{};
+  std::chrono::milliseconds m_threshold{};
+  post_fn_t m_post;
+  callback_t m_callback;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::thread m_thread;
+  bool m_is_stopping{};
+  std::size_t m_task_depth{};
+  clock::time_point m_task_start;
+  std::string m_task_site;
+  bool m_is_task_reported{};
+  std::vector<report> m_reports;
+  stats m_stats;
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_STALL_WATCHDOG_HH
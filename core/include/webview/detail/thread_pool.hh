@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_THREAD_POOL_HH
+#define WEBVIEW_DETAIL_THREAD_POOL_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace webview {
+namespace detail {
+
+// A fixed number of worker threads that run posted functions in order.
+class thread_pool {
+public:
+  explicit thread_pool(std::size_t thread_count) {
+    if (thread_count == 0) {
+      thread_count = 1;
+    }
+    m_threads.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      m_threads.emplace_back([this] { work(); });
+    }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  // Waits for the functions that have already been posted.
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_is_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto &thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  // A pool shared by the library with one thread per hardware thread.
+  static thread_pool &shared() {
+    static thread_pool pool{std::thread::hardware_concurrency()};
+    return pool;
+  }
+
+  void post(std::function<void()> fn) {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_queue.push_back(std::move(fn));
+    }
+    m_cv.notify_one();
+  }
+
+  std::size_t size() const { return m_threads.size(); }
+
+private:
+  void work() {
+    for (;;) {
+      std::function<void()> fn;
+      {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_cv.wait(lock, [this] { return m_is_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+          return;
+        }
+        fn = std::move(m_queue.front());
+        m_queue.pop_front();
+      }
+      fn();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_queue;
+  std::vector<std::thread> m_threads;
+  bool m_is_stopping{};
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_THREAD_POOL_HH
@@ -0,0 +1,352 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Serge Zaitsev
+ * Copyright (c) 2022 Steffen André Langnes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WEBVIEW_DETAIL_TRACER_HH
+#define WEBVIEW_DETAIL_TRACER_HH
+
+#if defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+
+#include "json.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace webview {
+namespace detail {
+
+// Records spans of work in the process while enabled and exports them in the
+// Chrome trace event format, which can be opened with Perfetto or
+// chrome://tracing.
+//
+// Each thread records into its own fixed-size ring buffer without locks,
+// overwriting its oldest events when full. Events are stored in atomic words
+// so that they can be exported while being written. Names and categories
+// must be string literals; call IDs and labels are copied and may be
+// truncated. The rings of exited threads are kept for export, up to
+// max_exited_rings, and released by clear().
+class tracer {
+public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t ring_capacity = 4096;
+  static constexpr std::size_t max_exited_rings = 8;
+
+  static tracer &instance() {
+    // Leaked on purpose so that threads can record during static destruction.
+    static auto *t = new tracer;
+    return *t;
+  }
+
+  bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+  void set_enabled(bool enabled) {
+    m_enabled.store(enabled, std::memory_order_relaxed);
+  }
+
+  // Records a span from start to end.
+  void record(const char *category, const char *name, clock::time_point start,
+              clock::time_point end, const std::string &id = {},
+              const std::string &label = {}) {
+    event e{};
+    e.category = category;
+    e.name = name;
+    e.start = start.time_since_epoch().count();
+    e.duration = (end - start).count();
+    copy_truncated(e.id, id);
+    copy_truncated(e.label, label);
+    std::uint64_t words[slot::word_count]{};
+    std::memcpy(words, &e, sizeof(e));
+
+    auto &ring = get_thread_ring();
+    // Only this thread writes to the ring.
+    auto index = ring.next.load(std::memory_order_relaxed);
+    auto &slot = ring.slots[index % ring_capacity];
+    // The sequence of a slot is odd while it is being written.
+    slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < slot::word_count; ++i) {
+      slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.sequence.store(index * 2 + 2, std::memory_order_release);
+    ring.next.store(index + 1, std::memory_order_release);
+  }
+
+  // Records a span that started at a time given by JavaScript as the number
+  // of milliseconds since the Unix epoch, e.g. performance.timeOrigin +
+  // performance.now().
+  void record_since_js_time(const char *category, const char *name,
+                            double js_time_ms, clock::time_point end,
+                            const std::string &id) {
+    auto since_epoch = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double, std::milli>(js_time_ms));
+    auto now_since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    auto start =
+        clock::now() -
+        (std::chrono::duration_cast<clock::duration>(now_since_epoch) -
+         since_epoch);
+    record(category, name, std::min(start, end), end, id);
+  }
+
+  // The call ID of the reply being evaluated on this thread, if any, so that
+  // backends can attribute the completion of evaluation to the call.
+  static std::string &current_call_id() {
+    static thread_local std::string id;
+    return id;
+  }
+
+  // Exports the recorded events as JSON in the Chrome trace event format.
+  std::string to_json() const {
+    std::vector<std::shared_ptr<ring>> rings;
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      rings = m_rings;
+    }
+    std::string json{"{\"displayTimeUnit\":\"ms\",\"traceEvents\":["};
+    bool first = true;
+    for (const auto &r : rings) {
+      auto end = r->next.load(std::memory_order_acquire);
+      auto begin = end > ring_capacity ? end - ring_capacity : 0;
+      begin = std::max(begin, r->cleared.load(std::memory_order_relaxed));
+      for (auto index = begin; index < end; ++index) {
+        auto &slot = r->slots[index % ring_capacity];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        std::uint64_t words[slot::word_count];
+        for (std::size_t i = 0; i < slot::word_count; ++i) {
+          words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Skip events that are being overwritten.
+        if (sequence != index * 2 + 2 ||
+            slot.sequence.load(std::memory_order_relaxed) != sequence) {
+          continue;
+        }
+        event data;
+        std::memcpy(&data, words, sizeof(data));
+        if (!first) {
+          json += ',';
+        }
+        first = false;
+        append_event(json, data, r->thread_id);
+      }
+    }
+    return json + "]}";
+  }
+
+  // Drops the recorded events and releases the rings of exited threads.
+  void clear() {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    for (auto &r : m_rings) {
+      // Writers own the next index, so events before it are hidden instead.
+      r->cleared.store(r->next.load(std::memory_order_acquire),
+                       std::memory_order_relaxed);
+    }
+    m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(),
+                                 [](const std::shared_ptr<ring> &r) {
+                                   return r->has_exited;
+                                 }),
+                  m_rings.end());
+  }
+
+private:
+  struct event {
+    const char *category;
+    const char *name;
+    clock::rep start;
+    clock::rep duration;
+    char id[40];
+    char label[40];
+  };
+
+  struct slot {
+    static constexpr std::size_t word_count =
+        (sizeof(event) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    std::atomic<std::uint64_t> sequence{};
+    std::atomic<std::uint64_t> words[word_count]{};
+  };
+  static_assert(std::is_trivially_copyable<event>::value,
+                "Events are copied through atomic words");
+
+  struct ring {
+    explicit ring(unsigned int thread_id) : thread_id{thread_id} {}
+    std::atomic<std::uint64_t> next{};
+    // Events before this index have been cleared.
+    std::atomic<std::uint64_t> cleared{};
+    unsigned int thread_id;
+    // Guarded by the mutex of the tracer.
+    bool has_exited{};
+    slot slots[ring_capacity];
+  };
+
+  // Unregisters the ring of a thread when the thread exits.
+  struct thread_ring_owner {
+    ring *r{};
+    ~thread_ring_owner() {
+      if (r) {
+        instance().release_ring(r);
+      }
+    }
+  };
+
+  tracer() = default;
+
+  ring &get_thread_ring() {
+    static thread_local thread_ring_owner owner;
+    if (!owner.r) {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      auto r = std::make_shared<ring>(++m_last_thread_id);
+      m_rings.push_back(r);
+      owner.r = r.get();
+    }
+    return *owner.r;
+  }
+
+  // Keeps the events of an exited thread for export unless there are none,
+  // or too many exited threads are kept already.
+  void release_ring(ring *released) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    std::size_t exited{};
+    for (auto it = m_rings.begin(); it != m_rings.end();) {
+      auto &r = *it;
+      if (r.get() == released) {
+        r->has_exited = true;
+        if (r->next.load(std::memory_order_relaxed) ==
+            r->cleared.load(std::memory_order_relaxed)) {
+          it = m_rings.erase(it);
+          continue;
+        }
+      }
+      exited += r->has_exited ? 1 : 0;
+      ++it;
+    }
+    // Rings are in order of creation, so the oldest ones are released.
+    for (auto it = m_rings.begin();
+         exited > max_exited_rings && it != m_rings.end();) {
+      if ((*it)->has_exited) {
+        it = m_rings.erase(it);
+        --exited;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  template <std::size_t N>
+  static void copy_truncated(char (&dest)[N], const std::string &src) {
+    auto size = std::min(src.size(), N - 1);
+    std::memcpy(dest, src.data(), size);
+    dest[size] = '\0';
+  }
+
+  // Formats a duration in microseconds with three decimals without
+  // depending on the C locale, e.g. "-1.500".
+  static std::string format_us(clock::duration duration) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+                  .count();
+    std::string sign = ns < 0 ? "-" : "";
+    auto magnitude = static_cast<unsigned long long>(ns < 0 ? -ns : ns);
+    auto fraction = std::to_string(magnitude % 1000);
+    return sign + std::to_string(magnitude / 1000) + "." +
+           std::string(3 - fraction.size(), '0') + fraction;
+  }
+
+  void append_event(std::string &json, const event &e,
+                    unsigned int thread_id) const {
+    auto start = clock::time_point{clock::duration{e.start}};
+    json += "{\"cat\":";
+    json += json_escape(e.category);
+    json += ",\"name\":";
+    json += json_escape(e.name);
+    json += ",\"ph\":\"X\",\"ts\":";
+    json += format_us(start - m_origin);
+    json += ",\"dur\":";
+    json += format_us(clock::duration{e.duration});
+    json += ",\"pid\":1,\"tid\":" + std::to_string(thread_id);
+    json += ",\"args\":{";
+    if (e.id[0]) {
+      json += "\"id\":" + json_escape(e.id);
+    }
+    if (e.label[0]) {
+      json += e.id[0] ? "," : "";
+      json += "\"label\":" + json_escape(e.label);
+    }
+    json += "}}";
+  }
+
+  std::atomic<bool> m_enabled{};
+  clock::time_point m_origin{clock::now()};
+  mutable std::mutex m_mutex;
+  std::vector<std::shared_ptr<ring>> m_rings;
+  unsigned int m_last_thread_id{};
+};
+
+// Records a span from construction to destruction when the tracer is
+// enabled.
+class trace_scope {
+public:
+  trace_scope(const char *category, const char *name,
+              const std::string &id = {}, const std::string &label = {})
+      : m_tracer{tracer::instance()} {
+    if (m_tracer.is_enabled()) {
+      m_category = category;
+      m_name = name;
+      m_id = id;
+      m_label = label;
+      m_start = tracer::clock::now();
+    }
+  }
+
+  ~trace_scope() {
+    if (m_name) {
+      m_tracer.record(m_category, m_name, m_start, tracer::clock::now(), m_id,
+                      m_label);
+    }
+  }
+
+  trace_scope(const trace_scope &) = delete;
+  trace_scope &operator=(const trace_scope &) = delete;
+
+private:
+  tracer &m_tracer;
+  const char *m_category{};
+  const char *m_name{};
+  std::string m_id;
+  std::string m_label;
+  tracer::clock::time_point m_start;
+};
+
+} // namespace detail
+} // namespace webview
+
+#endif // defined(__cplusplus) && !defined(WEBVIEW_HEADER)
+#endif // WEBVIEW_DETAIL_TRACER_HH
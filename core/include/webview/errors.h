@@ -43,6 +43,8 @@
  * Refer to specific functions regarding handling of other codes.
  */
 typedef enum {
+  /// The operation is not supported by the backend.
+  WEBVIEW_ERROR_NOT_SUPPORTED = -6,
   /// Missing dependency.
   WEBVIEW_ERROR_MISSING_DEPENDENCY = -5,
   /// Operation canceled.
@@ -78,4 +78,27 @@ typedef enum {
   WEBVIEW_HINT_FIXED
 } webview_hint_t;
 
+/// The priority class of work dispatched to the main/GUI thread.
+typedef enum {
+  /// Latency-critical work e.g. replies to user input. Runs before input
+  /// events and rendering.
+  WEBVIEW_DISPATCH_PRIORITY_URGENT,
+  /// The priority of work dispatched without a priority.
+  WEBVIEW_DISPATCH_PRIORITY_NORMAL,
+  /// Work that can wait until the main loop has nothing more important to do.
+  /// Runs one function per iteration of the main loop.
+  WEBVIEW_DISPATCH_PRIORITY_BACKGROUND
+} webview_dispatch_priority_t;
+
+/// A file descriptor polled by the event loop of a webview. The event flags
+/// have the same values as those used with @c poll() e.g. @c POLLIN.
+typedef struct {
+  /// The file descriptor.
+  int fd;
+  /// The events to poll for.
+  unsigned short events;
+  /// The events that occurred, set by the caller after polling.
+  unsigned short revents;
+} webview_poll_fd_t;
+
 #endif // WEBVIEW_TYPES_H
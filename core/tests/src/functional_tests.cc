@@ -8,8 +8,19 @@
 
 #include "webview/webview.h"
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef WEBVIEW_PLATFORM_WINDOWS
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 // This test should only run on Windows to enable us to perform a controlled
 // "warm-up" of MS WebView2 in order to avoid the initial test from
@@ -26,12 +37,298 @@ TEST_CASE("# Warm-up") {
 }
 #endif
 
+#ifdef WEBVIEW_GTK
+TEST_CASE("Use the default GTK main context") {
+  // The thread-default context at creation does not matter.
+  auto *context = g_main_context_new();
+  g_main_context_push_thread_default(context);
+  webview::webview w(false, nullptr);
+  g_main_context_pop_thread_default(context);
+  g_main_context_unref(context);
+  w.dispatch([&] { w.terminate(); });
+  w.run();
+}
+#endif
+
 TEST_CASE("Start app loop and terminate it") {
   webview::webview w(false, nullptr);
   w.dispatch([&]() { w.terminate(); });
   w.run();
 }
 
+TEST_CASE("Step app loop until it is terminated") {
+  webview::webview w(false, nullptr);
+  w.dispatch([&]() { w.terminate(); });
+  auto res = w.step(0);
+  if (res.has_error() && res.error().code() == WEBVIEW_ERROR_NOT_SUPPORTED) {
+    return;
+  }
+  while (res.ok()) {
+    res = w.step(100);
+  }
+  REQUIRE(res.error().code() == WEBVIEW_ERROR_CANCELED);
+}
+
+#ifndef WEBVIEW_PLATFORM_WINDOWS
+TEST_CASE("Poll app loop from an external reactor") {
+  webview::webview w(false, nullptr);
+  w.dispatch([&]() { w.terminate(); });
+  std::vector<webview_poll_fd_t> fds;
+  for (;;) {
+    auto timeout = w.poll_prepare(fds);
+    if (timeout.has_error()) {
+      REQUIRE(timeout.error().code() == WEBVIEW_ERROR_NOT_SUPPORTED);
+      return;
+    }
+    std::vector<pollfd> poll_fds;
+    for (const auto &fd : fds) {
+      poll_fds.push_back({fd.fd, static_cast<short>(fd.events), 0});
+    }
+    REQUIRE(poll(poll_fds.data(), poll_fds.size(), timeout.value()) >= 0);
+    for (std::size_t i = 0; i < fds.size(); ++i) {
+      fds[i].revents = static_cast<unsigned short>(poll_fds[i].revents);
+    }
+    auto res = w.poll_dispatch(fds);
+    if (res.has_error()) {
+      REQUIRE(res.error().code() == WEBVIEW_ERROR_CANCELED);
+      break;
+    }
+  }
+}
+#endif
+
+TEST_CASE("Record binding call metrics") {
+  webview::webview w(false, nullptr);
+  w.set_metrics_enabled(true);
+  w.bind("increment", [](const std::string &req) -> std::string {
+    return std::to_string(std::stoi(req.substr(1)) + 1);
+  });
+  w.bind("done", [&](const std::string & /*req*/) -> std::string {
+    w.terminate();
+    return "";
+  });
+  w.set_html(R"html(<script>
+    window.increment(1).then(() => window.increment(2)).then(window.done);
+  </script>)html");
+  w.run();
+  auto metrics = w.get_binding_metrics().get_snapshots();
+  REQUIRE(metrics.size() == 2);
+  REQUIRE(metrics[1].name == "increment");
+  REQUIRE(metrics[1].calls == 2);
+  REQUIRE(metrics[1].in_flight == 0);
+  REQUIRE(metrics[1].handler.count() == 2);
+  REQUIRE(metrics[1].resolve.count() == 2);
+
+  size_t size{};
+  REQUIRE(webview_get_stats(&w, nullptr, &size) ==
+          WEBVIEW_ERROR_INVALID_ARGUMENT);
+  std::string json(size, '\0');
+  REQUIRE(webview_get_stats(&w, &json[0], &size) == WEBVIEW_ERROR_OK);
+  REQUIRE(json.find("\"increment\":{\"calls\":2,") != std::string::npos);
+}
+
+TEST_CASE("Measure iterations of the event loop") {
+  webview::webview w(false, nullptr);
+  REQUIRE(webview_set_loop_monitoring_enabled(&w, 1) == WEBVIEW_ERROR_OK);
+  w.bind("done", [&](const std::string & /*req*/) -> std::string {
+    w.terminate();
+    return "";
+  });
+  w.set_html("<script>window.done();</script>");
+  w.run();
+  auto stats = w.get_loop_stats();
+  REQUIRE(stats.iterations > 0);
+  REQUIRE(stats.busy_ns.count() == stats.iterations);
+  REQUIRE(stats.owned_busy_ns > 0);
+  REQUIRE(stats.owned_busy_ns <= stats.total_busy_ns);
+  REQUIRE(w.get_stats_json().find("\"loop\":{\"iterations\":") !=
+          std::string::npos);
+}
+
+TEST_CASE("Report stalls of the event loop") {
+  webview::webview w(false, nullptr);
+  std::atomic<int> finished_stalls{};
+  REQUIRE(w.set_stall_watchdog(
+               std::chrono::milliseconds{20},
+               [&](const std::string &site, std::chrono::milliseconds duration,
+                   bool finished) {
+                 if (finished && site == "binding slow" &&
+                     duration.count() >= 100) {
+                   ++finished_stalls;
+                 }
+               })
+              .ok());
+  w.bind("slow", [](const std::string & /*req*/) -> std::string {
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    return "";
+  });
+  w.bind("done", [&](const std::string & /*req*/) -> std::string {
+    w.terminate();
+    return "";
+  });
+  w.set_html("<script>window.slow().then(window.done);</script>");
+  w.run();
+  auto stats = w.get_stall_stats();
+  REQUIRE(stats.sites["binding slow"] == 1);
+  REQUIRE(w.get_stats_json().find("\"binding slow\":1") != std::string::npos);
+  // Reports are delivered asynchronously by the watchdog thread.
+  for (int i = 0; i < 100 && finished_stalls == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  REQUIRE(w.set_stall_watchdog(std::chrono::milliseconds::zero()).ok());
+  REQUIRE(finished_stalls == 1);
+}
+
+TEST_CASE("Trace binding calls") {
+  webview::webview w(false, nullptr);
+  w.set_tracing_enabled(true);
+  w.bind("done", [&](const std::string & /*req*/) -> std::string {
+    w.terminate();
+    return "";
+  });
+  w.set_html("<script>window.done();</script>");
+  w.run();
+  w.set_tracing_enabled(false);
+
+  size_t size{};
+  REQUIRE(webview_get_trace(&w, nullptr, &size) ==
+          WEBVIEW_ERROR_INVALID_ARGUMENT);
+  std::string json(size, '\0');
+  REQUIRE(webview_get_trace(&w, &json[0], &size) == WEBVIEW_ERROR_OK);
+  REQUIRE(json.find("\"name\":\"handler\"") != std::string::npos);
+  REQUIRE(json.find("\"label\":\"done\"") != std::string::npos);
+}
+
+TEST_CASE("Get results of work dispatched from another thread") {
+  webview::webview w(false, nullptr);
+  // Runs inline on the main/GUI thread instead of deadlocking.
+  REQUIRE(w.dispatch_sync([] { return 1; }) == 1);
+  bool ran_on_ui_thread{};
+  std::string value;
+  std::future<int> failed;
+  std::thread worker{[&] {
+    ran_on_ui_thread =
+        w.dispatch_future([&] { return w.is_ui_thread(); }).get();
+    value = w.dispatch_sync([] { return std::string{"a"}; });
+    failed = w.dispatch_future([]() -> int { throw std::exception{}; });
+    failed.wait();
+    w.dispatch_sync([&] { w.terminate(); });
+  }};
+  w.run();
+  worker.join();
+  REQUIRE(ran_on_ui_thread);
+  REQUIRE(value == "a");
+  REQUIRE_THROW(std::exception, [&] { failed.get(); });
+}
+
+#ifdef WEBVIEW_HAVE_COROUTINES
+TEST_CASE("Bind a coroutine") {
+  using webview::detail::task;
+  webview::webview w(false, nullptr);
+  w.bind_task("compute", [&](std::string req) -> task<std::string> {
+    co_await webview::detail::resume_on_worker_pool();
+    auto on_worker = !w.is_ui_thread();
+    co_await w.resume_on_ui_thread();
+    REQUIRE(on_worker);
+    REQUIRE(w.is_ui_thread());
+    co_return req;
+  });
+  w.bind("done", [&](const std::string &req) -> std::string {
+    REQUIRE(req == "[[1,2]]");
+    w.terminate();
+    return "";
+  });
+  w.set_html("<script>window.compute(1, 2).then(window.done);</script>");
+  w.run();
+}
+#endif
+
+TEST_CASE("Run an idle task in slices") {
+  webview::webview w(false, nullptr);
+  int remaining = 1000;
+  REQUIRE(w.post_idle_task([&](const webview::detail::idle_deadline &deadline) {
+              while (remaining > 0 && !deadline.has_expired()) {
+                --remaining;
+              }
+              if (remaining > 0) {
+                return true;
+              }
+              w.terminate();
+              return false;
+            }).ok());
+  w.run();
+  REQUIRE(remaining == 0);
+}
+
+TEST_CASE("Run timers on the app loop") {
+  webview::webview w(false, nullptr);
+  unsigned int ticks{};
+  auto interval = w.set_interval([&] { ++ticks; }, 5);
+  if (interval.has_error()) {
+    REQUIRE(interval.error().code() == WEBVIEW_ERROR_NOT_SUPPORTED);
+    return;
+  }
+  auto timeout = w.set_timeout(
+      [&] {
+        REQUIRE(ticks > 0);
+        REQUIRE(w.remove_source(interval.value()).ok());
+        w.terminate();
+      },
+      50);
+  REQUIRE(timeout.ok());
+  w.run();
+  // One-shot timers are removed after being called.
+  REQUIRE(w.remove_source(timeout.value()).error().code() ==
+          WEBVIEW_ERROR_NOT_FOUND);
+}
+
+#ifndef WEBVIEW_PLATFORM_WINDOWS
+TEST_CASE("Watch a file descriptor on the app loop") {
+  webview::webview w(false, nullptr);
+  int fds[2]{};
+  REQUIRE(pipe(fds) == 0);
+  auto watch = w.watch_fd(fds[0], POLLIN, [&](unsigned short revents) {
+    REQUIRE((revents & POLLIN) != 0);
+    char c{};
+    REQUIRE(read(fds[0], &c, 1) == 1);
+    REQUIRE(c == 'x');
+    w.terminate();
+  });
+  if (watch.has_error()) {
+    REQUIRE(watch.error().code() == WEBVIEW_ERROR_NOT_SUPPORTED);
+  } else {
+    REQUIRE(write(fds[1], "x", 1) == 1);
+    w.run();
+    REQUIRE(w.remove_source(watch.value()).ok());
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_CASE("Remove a file descriptor watch after a hangup") {
+  webview::webview w(false, nullptr);
+  int fds[2]{};
+  REQUIRE(pipe(fds) == 0);
+  int calls = 0;
+  auto watch = w.watch_fd(fds[0], POLLIN, [&](unsigned short revents) {
+    ++calls;
+    REQUIRE((revents & POLLHUP) != 0);
+  });
+  if (watch.has_error()) {
+    REQUIRE(watch.error().code() == WEBVIEW_ERROR_NOT_SUPPORTED);
+  } else {
+    close(fds[1]);
+    // Give a spinning watch the chance to be called again.
+    REQUIRE(w.set_timeout([&] { w.terminate(); }, 100).ok());
+    w.run();
+    REQUIRE(calls == 1);
+    REQUIRE(w.remove_source(watch.value()).error().code() ==
+            WEBVIEW_ERROR_NOT_FOUND);
+  }
+  close(fds[0]);
+}
+#endif
+
 void cb_assert_arg(webview_t w, void *arg) {
   REQUIRE(w != nullptr);
   REQUIRE(memcmp(arg, "arg", 3) == 0);
@@ -247,6 +544,139 @@ TEST_CASE("The string returned of a binding call must not be JS") {
   w.run();
 }
 
+TEST_CASE("Call JS function with named arguments") {
+  webview::webview w(false, nullptr);
+  w.bind("ready", [&](const std::string & /*req*/) -> std::string {
+    w.call_js("window.done(a + b, s, flag)",
+              {{"a", 1}, {"b", 2}, {"s", "a\"b"}, {"flag", true}});
+    return "";
+  });
+  w.bind("done", [&](const std::string &req) -> std::string {
+    REQUIRE(req == R"([3,"a\"b",true])");
+    w.terminate();
+    return "";
+  });
+  w.set_html("<script>window.ready();</script>");
+  w.run();
+}
+
+TEST_CASE("Bind a function that accepts binary parameters") {
+  webview::webview w(false, nullptr);
+  w.bind_buffers(
+      "test",
+      [&](const std::string &id, const std::string &req,
+          const std::vector<webview::detail::buffer> &buffers, void *) {
+        // Backends that cannot pass buffers serialize typed arrays as usual.
+        if (buffers.empty()) {
+          REQUIRE(req == R"(["a",{"0":1,"1":2,"2":3}])");
+        } else {
+          REQUIRE(req == R"(["a",{"$buffer":0}])");
+          REQUIRE(buffers.size() == 1);
+          REQUIRE(buffers[0].to_string() == std::string("\x01\x02\x03"));
+        }
+        w.resolve(id, 0, "");
+        w.terminate();
+      },
+      nullptr);
+  w.set_html("<script>window.test('a', new Uint8Array([1, 2, 3]));</script>");
+  w.run();
+}
+
+TEST_CASE("Load HTML from a buffer") {
+  using webview::detail::buffer;
+  webview::webview w(false, nullptr);
+  w.bind("fromBuffer", [&](const std::string &req) -> std::string {
+    REQUIRE(req == "[\"hello\"]");
+    w.terminate();
+    return "";
+  });
+  std::string html{"<script>window.fromBuffer('hello');</script>"};
+  REQUIRE(w.set_html(buffer{std::move(html)}).ok());
+  w.run();
+}
+
+TEST_CASE("Transfer binary data through the IPC scheme") {
+  using webview::detail::buffer;
+  webview::webview w(false, nullptr);
+  auto url = w.publish_buffer(buffer{std::string{"\x01\x02\x03"}});
+  if (url.has_error()) {
+    REQUIRE(url.error().code() == WEBVIEW_ERROR_NOT_SUPPORTED);
+    return;
+  }
+  w.bind_binary("reverse", [](const buffer &body) {
+    auto data = body.to_string();
+    return buffer{std::string{data.rbegin(), data.rend()}};
+  });
+  w.bind("done", [&](const std::string &req) -> std::string {
+    REQUIRE(req == "[[1,2,3],[6,5,4],404]");
+    w.terminate();
+    return "";
+  });
+  w.set_html(R"html(<script>
+    function bytes(b) {
+      return Array.from(new Uint8Array(b));
+    }
+    Promise.all([
+      fetch(")html" +
+             url.value() + R"html(").then(r => r.arrayBuffer()).then(bytes),
+      window.__webview__.callBinary("reverse", new Uint8Array([4, 5, 6]))
+        .then(bytes),
+      // Calls without the token must be rejected.
+      fetch("webview-ipc://localhost/call/reverse", {
+        method: "POST",
+        body: new Uint8Array([4, 5, 6])
+      }).then(r => r.status)
+    ]).then(r => window.done(r[0], r[1], r[2]));
+  </script>)html");
+  w.run();
+}
+
+TEST_CASE("Evaluate JS code and get the result") {
+  webview::webview w(false, nullptr);
+  auto check_undefined = [&](int status, const std::string &result) {
+    REQUIRE(status == 0);
+    REQUIRE(result.empty());
+    w.terminate();
+  };
+  auto check_object = [&](int status, const std::string &result) {
+    REQUIRE(status == 0);
+    REQUIRE(result == R"({"a":[1,"b"],"c":42})");
+    w.eval_async("undefined", check_undefined);
+  };
+  w.bind("ready", [&](const std::string & /*req*/) -> std::string {
+    REQUIRE(w.eval_async("({a: [1, 'b'], c: 6 * 7})", check_object).ok());
+    return "";
+  });
+  w.set_html("<script>window.ready();</script>");
+  w.run();
+}
+
+TEST_CASE("Use C API to evaluate JS code that throws an exception") {
+  struct context_t {
+    webview_t w;
+    int status;
+  } context{};
+  auto ready = +[](const char *id, const char * /*req*/, void *arg) {
+    auto *context = static_cast<context_t *>(arg);
+    webview_eval_async(
+        context->w, "throw new Error('oops')",
+        +[](webview_t w, int status, const char *result, void *arg_) {
+          auto *context_ = static_cast<context_t *>(arg_);
+          context_->status = status;
+          REQUIRE(std::string{result}.find("oops") != std::string::npos);
+          webview_terminate(w);
+        },
+        context);
+    webview_return(context->w, id, 0, "");
+  };
+  context.w = webview_create(false, nullptr);
+  webview_bind(context.w, "ready", ready, &context);
+  webview_set_html(context.w, "<script>window.ready();</script>");
+  webview_run(context.w);
+  webview_destroy(context.w);
+  REQUIRE(context.status != 0);
+}
+
 TEST_CASE("webview_version()") {
   auto vi = webview_version();
   REQUIRE(vi);
@@ -304,13 +734,29 @@ TEST_CASE("Bad C API usage without crash") {
   ASSERT_WEBVIEW_FAILED(webview_navigate(w, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_set_title(w, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_set_html(w, nullptr));
+  ASSERT_WEBVIEW_FAILED(
+      webview_set_html_buffer(w, nullptr, 1, nullptr, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_init(w, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_eval(w, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_eval_async(w, nullptr, nullptr, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_bind(w, nullptr, nullptr, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_unbind(w, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_return(w, nullptr, 0, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_dispatch(w, nullptr, nullptr));
   ASSERT_WEBVIEW_FAILED(webview_terminate(w));
+  ASSERT_WEBVIEW_FAILED(webview_step(w, 0));
+  ASSERT_WEBVIEW_FAILED(webview_set_metrics_enabled(w, 1));
+  ASSERT_WEBVIEW_FAILED(webview_get_stats(w, nullptr, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_set_loop_monitoring_enabled(w, 1));
+  ASSERT_WEBVIEW_FAILED(webview_set_stall_watchdog(w, 0, nullptr, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_set_tracing_enabled(w, 1));
+  ASSERT_WEBVIEW_FAILED(webview_get_trace(w, nullptr, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_set_timeout(w, 0, nullptr, nullptr, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_set_interval(w, 0, nullptr, nullptr, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_watch_fd(w, -1, 0, nullptr, nullptr, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_remove_source(w, 0));
+  ASSERT_WEBVIEW_FAILED(webview_poll_prepare(w, nullptr, nullptr, nullptr));
+  ASSERT_WEBVIEW_FAILED(webview_poll_dispatch(w, nullptr, 1));
   ASSERT_WEBVIEW_FAILED(webview_run(w));
   ASSERT_WEBVIEW_FAILED(webview_destroy(w));
 }
@@ -1,6 +1,23 @@
 #include "webview/test_driver.hh"
 #include "webview/webview.h"
 
+#include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 TEST_CASE("Ensure that JSON parsing works") {
   auto J = webview::detail::json_parse;
   // Valid input with expected output
@@ -66,6 +83,866 @@ TEST_CASE("Ensure that JSON escaping works") {
   REQUIRE(json_escape(R"(alert("gotcha"))", false) == expected_gotcha);
 }
 
+TEST_CASE("Ensure that number formatting ignores the C locale") {
+  using namespace webview::detail;
+  REQUIRE(json_number(1.5) == "1.5");
+  REQUIRE(json_number(-0.25, 3) == "-0.25");
+  REQUIRE(json_number(1e21) == "1e+21");
+  REQUIRE(json_parse_number("1.25") == 1.25);
+  REQUIRE(json_parse_number("-3e2") == -300);
+  REQUIRE(json_parse_number("x", -1) == -1);
+  // GTK sets the C locale from the environment, which may use a decimal
+  // comma. Skipped if no such locale is installed.
+  std::string previous{std::setlocale(LC_NUMERIC, nullptr)};
+  for (const char *name :
+       {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8"}) {
+    if (std::setlocale(LC_NUMERIC, name)) {
+      REQUIRE(json_number(1.5) == "1.5");
+      REQUIRE(js_arg{2.5}.to_js() == "2.5");
+      REQUIRE(json_parse_number("1.25") == 1.25);
+      break;
+    }
+  }
+  std::setlocale(LC_NUMERIC, previous.c_str());
+}
+
+TEST_CASE("Ensure that JS function call generation works") {
+  using namespace webview::detail;
+
+  REQUIRE(create_js_function_call("return 1", {}) ==
+          "(function() {\nreturn 1\n})()");
+  REQUIRE(create_js_function_call("return a + b", {{"a", 1}, {"b", 2.5}}) ==
+          "(function(a, b) {\nreturn a + b\n})(1, 2.5)");
+  // Strings must be escaped and must not be executed as JS code.
+  REQUIRE(create_js_function_call("return s", {{"s", "alert(\"gotcha\")"}}) ==
+          R"js((function(s) {
+return s
+})("alert(\"gotcha\")"))js");
+  REQUIRE(js_arg{true}.to_js() == "true");
+  REQUIRE(js_arg{false}.to_js() == "false");
+  REQUIRE(js_arg{-42}.to_js() == "-42");
+  REQUIRE(js_arg{0.1}.to_js() == "0.10000000000000001");
+  REQUIRE(js_arg{std::numeric_limits<double>::infinity()}.to_js() ==
+          "Infinity");
+  REQUIRE(js_arg{std::numeric_limits<double>::quiet_NaN()}.to_js() == "NaN");
+}
+
+TEST_CASE("buffer class") {
+  using namespace webview::detail;
+
+  REQUIRE(buffer{}.empty());
+  REQUIRE(buffer{}.to_string().empty());
+
+  buffer b{std::string{"hello world"}};
+  REQUIRE(b.size() == 11);
+  REQUIRE(b.to_string() == "hello world");
+  REQUIRE(b.slice(6, 5).to_string() == "world");
+  REQUIRE(b.slice(6, 5).owner() == b.owner());
+  REQUIRE(b.slice(6, 100).to_string() == "world");
+  REQUIRE(b.slice(100, 1).empty());
+
+  const char bytes[] = {1, 2, 3};
+  auto copy = buffer::copy(bytes, sizeof(bytes));
+  REQUIRE(copy.size() == 3);
+  REQUIRE(copy.data() != reinterpret_cast<const unsigned char *>(bytes));
+  REQUIRE(copy.data()[2] == 3);
+}
+
+TEST_CASE("Ensure that byte range parsing works") {
+  using webview::detail::parse_byte_range;
+  std::uint64_t offset{};
+  std::uint64_t length{};
+
+  REQUIRE(parse_byte_range("bytes=0-499", 1000, offset, length));
+  REQUIRE(offset == 0 && length == 500);
+  REQUIRE(parse_byte_range("bytes=500-", 1000, offset, length));
+  REQUIRE(offset == 500 && length == 500);
+  REQUIRE(parse_byte_range("bytes=-100", 1000, offset, length));
+  REQUIRE(offset == 900 && length == 100);
+  REQUIRE(parse_byte_range("bytes=-2000", 1000, offset, length));
+  REQUIRE(offset == 0 && length == 1000);
+  REQUIRE(parse_byte_range("bytes=990-2000", 1000, offset, length));
+  REQUIRE(offset == 990 && length == 10);
+
+  REQUIRE(!parse_byte_range("bytes=1000-", 1000, offset, length));
+  REQUIRE(!parse_byte_range("bytes=5-4", 1000, offset, length));
+  REQUIRE(!parse_byte_range("bytes=-", 1000, offset, length));
+  REQUIRE(!parse_byte_range("bytes=-0", 1000, offset, length));
+  REQUIRE(!parse_byte_range("bytes=0-1,5-6", 1000, offset, length));
+  REQUIRE(!parse_byte_range("items=0-1", 1000, offset, length));
+  REQUIRE(!parse_byte_range("bytes=0-99999999999999999999", 1000, offset,
+                            length));
+}
+
+TEST_CASE("Stream large resources in bounded chunks") {
+  using namespace webview::detail;
+  // Larger than what fits into memory, or into a 32-bit size_t.
+  const std::uint64_t size = std::uint64_t{10} << 30;
+  std::size_t largest_read{};
+  content_reader_t read = [&](std::uint64_t offset, std::size_t length,
+                              buffer &out) {
+    if (length > largest_read) {
+      largest_read = length;
+    }
+    out = buffer{std::string(length, static_cast<char>('a' + offset % 26))};
+    return true;
+  };
+  scheme_request request;
+  auto response = make_resource_response(request, size, read, "video/mp4");
+  REQUIRE(response.status == 200);
+  REQUIRE(response.body.size() == 0);
+  REQUIRE(response.body_generator);
+  std::string chunk;
+  REQUIRE(response.body_generator(chunk));
+  REQUIRE(chunk.size() == resource_chunk_size);
+
+  // Open-ended ranges are capped.
+  request.headers["Range"] = "bytes=0-";
+  response = make_resource_response(request, size, read, "video/mp4");
+  REQUIRE(response.status == 206);
+  REQUIRE(response.headers["Content-Range"] ==
+          "bytes 0-" + std::to_string(max_open_range_size - 1) + "/" +
+              std::to_string(size));
+  std::uint64_t total{};
+  bool more = true;
+  while (more) {
+    chunk.clear();
+    more = response.body_generator(chunk);
+    total += chunk.size();
+  }
+  REQUIRE(total == max_open_range_size);
+  REQUIRE(largest_read == resource_chunk_size);
+
+  // Small ranges are read at once.
+  request.headers["Range"] = "bytes=" + std::to_string(size - 4) + "-";
+  response = make_resource_response(request, size, read, "video/mp4");
+  REQUIRE(response.status == 206);
+  REQUIRE(!response.body_generator);
+  REQUIRE(response.body.size() == 4);
+}
+
+TEST_CASE("Ensure that MIME type guessing works") {
+  using webview::detail::guess_mime_type;
+  REQUIRE(guess_mime_type("/index.html") == "text/html");
+  REQUIRE(guess_mime_type("/js/APP.JS") == "text/javascript");
+  REQUIRE(guess_mime_type("/video.mp4") == "video/mp4");
+  REQUIRE(guess_mime_type("/file.unknown") == "application/octet-stream");
+  REQUIRE(guess_mime_type("/dir.html/file") == "application/octet-stream");
+}
+
+TEST_CASE("Ensure that HTTP date formatting works") {
+  REQUIRE(webview::detail::format_http_date(784111777) ==
+          "Sun, 06 Nov 1994 08:49:37 GMT");
+}
+
+TEST_CASE("directory_mount class") {
+  using webview::detail::directory_mount;
+  directory_mount mount{"/srv/www/"};
+  REQUIRE(mount.root() == "/srv/www");
+
+  std::string path;
+  REQUIRE(mount.resolve("/a/b.txt", path));
+  REQUIRE(path == "/srv/www/a/b.txt");
+  REQUIRE(mount.resolve("/", path));
+  REQUIRE(path == "/srv/www/index.html");
+  REQUIRE(mount.resolve("/a/./b%20c.txt", path));
+  REQUIRE(path == "/srv/www/a/b c.txt");
+  REQUIRE(mount.resolve("//a//", path));
+  REQUIRE(path == "/srv/www/a/index.html");
+
+  REQUIRE(!mount.resolve("/../etc/passwd", path));
+  REQUIRE(!mount.resolve("/a/%2e%2e/%2e%2e/etc/passwd", path));
+  REQUIRE(!mount.resolve("/a%5c..%5cb", path));
+  REQUIRE(!mount.resolve("/a%00b", path));
+  REQUIRE(!mount.resolve("/a%2", path));
+}
+
+#ifndef _WIN32
+TEST_CASE("Serve files with directory_mount") {
+  using namespace webview::detail;
+  char temp[] = "/tmp/webview_mount_XXXXXX";
+  REQUIRE(mkdtemp(temp) != nullptr);
+  std::string dir{temp};
+  auto write = [](const std::string &path, const std::string &content) {
+    auto *file = std::fopen(path.c_str(), "wb");
+    REQUIRE(file != nullptr);
+    std::fwrite(content.data(), 1, content.size(), file);
+    std::fclose(file);
+  };
+  REQUIRE(mkdir((dir + "/www").c_str(), 0700) == 0);
+  write(dir + "/www/a.txt", "hello");
+  write(dir + "/secret.txt", "secret");
+  REQUIRE(symlink("../secret.txt", (dir + "/www/link.txt").c_str()) == 0);
+  REQUIRE(symlink("a.txt", (dir + "/www/alias.txt").c_str()) == 0);
+
+  directory_mount mount{dir + "/www"};
+  scheme_request request;
+  request.path = "/a.txt";
+  auto response = mount.serve(request);
+  REQUIRE(response.status == 200);
+  REQUIRE(response.body.to_string() == "hello");
+
+  request.headers["Range"] = "bytes=1-3";
+  response = mount.serve(request);
+  REQUIRE(response.status == 206);
+  REQUIRE(response.body.to_string() == "ell");
+  request.headers.clear();
+
+  request.path = "/alias.txt";
+  REQUIRE(mount.serve(request).body.to_string() == "hello");
+  request.path = "/link.txt";
+  REQUIRE(mount.serve(request).status == 403);
+  request.path = "/missing.txt";
+  REQUIRE(mount.serve(request).status == 404);
+
+  for (const char *name : {"/www/a.txt", "/www/link.txt", "/www/alias.txt",
+                           "/secret.txt"}) {
+    std::remove((dir + name).c_str());
+  }
+  rmdir((dir + "/www").c_str());
+  rmdir(dir.c_str());
+}
+#endif
+
+TEST_CASE("response_cache class") {
+  using namespace webview::detail;
+  int calls = 0;
+  scheme_handler_t handler = [&](const scheme_request &request) {
+    ++calls;
+    REQUIRE(request.headers.empty());
+    scheme_response response;
+    response.content_type = "text/plain";
+    response.body = buffer{request.path.substr(1) + " content"};
+    return response;
+  };
+  response_cache cache{16};
+  auto cached = cache.wrap(handler);
+
+  scheme_request request;
+  request.uri = "app://localhost/a";
+  request.path = "/a";
+  auto response = cached(request);
+  REQUIRE(calls == 1);
+  REQUIRE(response.status == 200);
+  REQUIRE(response.body.to_string() == "a content");
+  REQUIRE(response.headers["Cache-Control"] == "no-cache");
+  auto etag = response.headers["ETag"];
+  REQUIRE(!etag.empty());
+  REQUIRE(!response.headers["Last-Modified"].empty());
+
+  response = cached(request);
+  REQUIRE(calls == 1);
+  REQUIRE(response.body.to_string() == "a content");
+
+  request.headers["If-None-Match"] = "\"other\", " + etag;
+  REQUIRE(cached(request).status == 304);
+  request.headers.clear();
+  request.headers["Range"] = "bytes=2-";
+  response = cached(request);
+  REQUIRE(response.status == 206);
+  REQUIRE(response.body.to_string() == "content");
+  REQUIRE(calls == 1);
+
+  // Exceeds the budget together with the first response
+  request.headers.clear();
+  request.uri = "app://localhost/bb";
+  request.path = "/bb";
+  REQUIRE(cached(request).status == 200);
+  REQUIRE(calls == 2);
+
+  auto stats = cache.get_stats();
+  REQUIRE(stats.hits == 3);
+  REQUIRE(stats.misses == 2);
+  REQUIRE(stats.evictions == 1);
+  REQUIRE(stats.entries == 1);
+  REQUIRE(stats.size == 10);
+
+  cache.clear();
+  REQUIRE(cache.get_stats().entries == 0);
+
+  // Streamed responses are not cached.
+  auto streamed = cache.wrap([&](const scheme_request &) {
+    ++calls;
+    scheme_response response;
+    response.body_generator = [](std::string &) { return false; };
+    return response;
+  });
+  request.uri = "app://localhost/stream";
+  request.path = "/stream";
+  REQUIRE(streamed(request).body_generator);
+  REQUIRE(streamed(request).body_generator);
+  REQUIRE(calls == 4);
+  REQUIRE(cache.get_stats().entries == 0);
+}
+
+TEST_CASE("dispatch_queues class") {
+  using namespace webview::detail;
+  dispatch_queues queues;
+  std::string order;
+  REQUIRE(queues.push(WEBVIEW_DISPATCH_PRIORITY_BACKGROUND,
+                      [&] { order += "b1"; }));
+  REQUIRE(!queues.push(WEBVIEW_DISPATCH_PRIORITY_BACKGROUND,
+                       [&] { order += "b2"; }));
+  REQUIRE(!queues.push(
+      WEBVIEW_DISPATCH_PRIORITY_BACKGROUND, [&] { order += "expired"; },
+      dispatch_queues::clock::now() - std::chrono::seconds{1}));
+  REQUIRE(queues.push(WEBVIEW_DISPATCH_PRIORITY_NORMAL, [&] {
+    order += "n1";
+    // Work queued while pumping waits for the next pump.
+    queues.push(WEBVIEW_DISPATCH_PRIORITY_NORMAL, [&] { order += "n2"; });
+  }));
+
+  REQUIRE(queues.pump(WEBVIEW_DISPATCH_PRIORITY_NORMAL));
+  REQUIRE(order == "n1");
+  REQUIRE(!queues.pump(WEBVIEW_DISPATCH_PRIORITY_NORMAL));
+  REQUIRE(order == "n1n2");
+
+  // Background work runs one item per pump.
+  REQUIRE(queues.pump(WEBVIEW_DISPATCH_PRIORITY_BACKGROUND));
+  REQUIRE(order == "n1n2b1");
+  REQUIRE(queues.pump(WEBVIEW_DISPATCH_PRIORITY_BACKGROUND));
+  REQUIRE(order == "n1n2b1b2");
+  REQUIRE(!queues.pump(WEBVIEW_DISPATCH_PRIORITY_BACKGROUND));
+  REQUIRE(order == "n1n2b1b2");
+
+  auto stats = queues.get_stats();
+  REQUIRE(stats.normal.dispatched == 2);
+  REQUIRE(stats.background.dispatched == 2);
+  REQUIRE(stats.background.dropped == 1);
+  REQUIRE(stats.background.pending == 0);
+  REQUIRE(stats.urgent.dispatched == 0);
+
+  // A queue stays scheduled when work throws and more work remains.
+  REQUIRE(queues.push(WEBVIEW_DISPATCH_PRIORITY_URGENT,
+                      [] { throw std::runtime_error{"failed"}; }));
+  REQUIRE(!queues.push(WEBVIEW_DISPATCH_PRIORITY_URGENT,
+                       [&] { order += "u1"; }));
+  REQUIRE_THROW(std::runtime_error,
+                [&] { queues.pump(WEBVIEW_DISPATCH_PRIORITY_URGENT); });
+  REQUIRE(order == "n1n2b1b2");
+  REQUIRE(queues.is_scheduled(WEBVIEW_DISPATCH_PRIORITY_URGENT));
+  REQUIRE(!queues.pump(WEBVIEW_DISPATCH_PRIORITY_URGENT));
+  REQUIRE(order == "n1n2b1b2u1");
+  REQUIRE(!queues.is_scheduled(WEBVIEW_DISPATCH_PRIORITY_URGENT));
+
+  // A queue whose pump could not be scheduled is scheduled by the next push.
+  REQUIRE(queues.push(WEBVIEW_DISPATCH_PRIORITY_URGENT, [] {}));
+  queues.unschedule(WEBVIEW_DISPATCH_PRIORITY_URGENT);
+  REQUIRE(queues.push(WEBVIEW_DISPATCH_PRIORITY_URGENT, [] {}));
+  REQUIRE(!queues.pump(WEBVIEW_DISPATCH_PRIORITY_URGENT));
+
+  queues.close();
+  REQUIRE(!queues.push(WEBVIEW_DISPATCH_PRIORITY_URGENT, [] {}));
+  REQUIRE(!queues.pump(WEBVIEW_DISPATCH_PRIORITY_URGENT));
+}
+
+TEST_CASE("idle_scheduler class") {
+  using namespace webview::detail;
+  idle_scheduler scheduler{std::chrono::hours{1}};
+  int a = 0;
+  int b = 0;
+  REQUIRE(scheduler.post([&](const idle_deadline &deadline) {
+    REQUIRE(deadline.time_remaining() > std::chrono::microseconds::zero());
+    return ++a < 3;
+  }));
+  REQUIRE(!scheduler.post([&](const idle_deadline &) { return ++b < 2; }));
+  REQUIRE(scheduler.pending() == 2);
+  // Tasks take turns until they are done or the slice has run out.
+  REQUIRE(!scheduler.run_slice());
+  REQUIRE(a == 3);
+  REQUIRE(b == 2);
+
+  // At least one task runs even when the budget is exceeded.
+  scheduler.set_budget(std::chrono::microseconds{1});
+  REQUIRE(scheduler.post([&](const idle_deadline &deadline) {
+    while (!deadline.has_expired()) {
+    }
+    return ++a < 5;
+  }));
+  REQUIRE(scheduler.run_slice());
+  REQUIRE(a == 4);
+  REQUIRE(!scheduler.run_slice());
+  REQUIRE(a == 5);
+}
+
+TEST_CASE("pool_allocator class") {
+  using namespace webview::detail;
+  struct item {
+    char data[40];
+  };
+  pool_allocator<item> allocator;
+  auto &pool = pool_allocator<item>::pool();
+  auto free_count = pool.free_count();
+  auto *a = allocator.allocate(1);
+  allocator.deallocate(a, 1);
+  REQUIRE(pool.free_count() == free_count + 1);
+  // Released blocks are reused.
+  auto *b = allocator.allocate(1);
+  REQUIRE(b == a);
+  REQUIRE(pool.free_count() == free_count);
+  allocator.deallocate(b, 1);
+  // Arrays bypass the pool.
+  auto *c = allocator.allocate(2);
+  allocator.deallocate(c, 2);
+  REQUIRE(pool.free_count() == free_count + 1);
+}
+
+#ifdef WEBVIEW_HAVE_COROUTINES
+TEST_CASE("task class") {
+  using namespace webview::detail;
+  auto add = [](int a, int b) -> task<int> { co_return a + b; };
+  auto fail = []() -> task<void> {
+    throw std::runtime_error{"failed"};
+    co_return;
+  };
+  auto chain = [&]() -> task<int> {
+    auto sum = co_await add(1, 2);
+    try {
+      co_await fail();
+    } catch (const std::runtime_error &) {
+      sum += 10;
+    }
+    co_return sum;
+  };
+  int *result{};
+  int value{};
+  start_task(chain(), [&](int *result_, std::exception_ptr error) {
+    REQUIRE(!error);
+    result = result_;
+    value = *result_;
+  });
+  REQUIRE(result != nullptr);
+  REQUIRE(value == 13);
+
+  // Coroutine frames are recycled.
+  auto *frame = frame_allocator::allocate(100);
+  frame_allocator::deallocate(frame, 100);
+  REQUIRE(frame_allocator::allocate(128) == frame);
+  frame_allocator::deallocate(frame, 128);
+}
+
+TEST_CASE("ui_thread_awaitable class") {
+  using namespace webview::detail;
+  // Keeps dispatched work until it is run or dropped.
+  struct fake_engine {
+    std::function<void()> work;
+    bool is_ui_thread() const { return false; }
+    webview::noresult dispatch(std::function<void()> fn,
+                               webview_dispatch_priority_t) {
+      work = std::move(fn);
+      return {};
+    }
+  } engine;
+  std::string events;
+  auto resume = [&]() -> task<void> {
+    try {
+      co_await ui_thread_awaitable<fake_engine>{engine};
+      events += "resumed;";
+    } catch (const webview::exception &e) {
+      REQUIRE(e.error().code() == WEBVIEW_ERROR_CANCELED);
+      events += "canceled;";
+    }
+  };
+  auto on_done = [&](std::exception_ptr error) {
+    REQUIRE(!error);
+    events += "done;";
+  };
+
+  start_task(resume(), on_done);
+  REQUIRE(events.empty());
+  engine.work();
+  REQUIRE(events == "resumed;done;");
+
+  // Dropping the work resumes the coroutine with an error.
+  events.clear();
+  start_task(resume(), on_done);
+  REQUIRE(events.empty());
+  engine.work = nullptr;
+  REQUIRE(events == "canceled;done;");
+}
+#endif
+
+TEST_CASE("latency_histogram class") {
+  using namespace webview::detail;
+  latency_histogram histogram;
+  REQUIRE(histogram.snapshot().percentile(50) == 0);
+  for (std::uint64_t i = 1; i <= 1000; ++i) {
+    histogram.record(i * 1000);
+  }
+  auto snapshot = histogram.snapshot();
+  REQUIRE(snapshot.count() == 1000);
+  REQUIRE(snapshot.min() == 1000);
+  REQUIRE(snapshot.max() == 1000000);
+  REQUIRE(snapshot.mean() == 500500);
+  // Within the precision of the histogram.
+  auto p50 = snapshot.percentile(50);
+  REQUIRE(p50 >= 500000 && p50 <= 500000 * 103 / 100);
+  auto p99 = snapshot.percentile(99);
+  REQUIRE(p99 >= 990000 && p99 <= 990000 * 103 / 100);
+  REQUIRE(snapshot.percentile(100) == 1000000);
+
+  for (std::uint64_t value : {std::uint64_t{0}, std::uint64_t{63},
+                              std::uint64_t{64}, std::uint64_t{12345},
+                              latency_histogram::max_value}) {
+    auto index = latency_histogram::bucket_index(value);
+    REQUIRE(index < latency_histogram::bucket_count);
+    REQUIRE(latency_histogram::bucket_upper_bound(index) >= value);
+  }
+}
+
+TEST_CASE("binding_metrics class") {
+  using namespace webview::detail;
+  using clock = binding_metrics::clock;
+  binding_metrics metrics;
+  metrics.set_enabled(true);
+  auto now = clock::now();
+  metrics.call_received("1", "a", now);
+  metrics.call_resolved("1", now + std::chrono::microseconds{5});
+  auto snapshots = metrics.get_snapshots();
+  REQUIRE(snapshots.size() == 1);
+  REQUIRE(snapshots[0].calls == 1);
+  REQUIRE(snapshots[0].in_flight == 0);
+  REQUIRE(snapshots[0].resolve.count() == 1);
+
+  // Calls that are never resolved are not tracked forever.
+  auto old = now - binding_metrics::max_pending_age() * 2;
+  const auto capacity =
+      binding_metrics::shard_count * binding_metrics::max_pending_per_shard;
+  for (std::size_t i = 0; i < capacity * 2; ++i) {
+    metrics.call_received(std::to_string(i), "b", i < capacity ? old : now);
+  }
+  REQUIRE(metrics.pending_calls() <= capacity);
+  snapshots = metrics.get_snapshots();
+  REQUIRE(snapshots.size() == 2);
+  REQUIRE(snapshots[1].calls == capacity * 2);
+  REQUIRE(snapshots[1].in_flight == metrics.pending_calls());
+
+  // Disabling forgets pending calls.
+  metrics.set_enabled(false);
+  REQUIRE(metrics.pending_calls() == 0);
+  REQUIRE(metrics.get_snapshots()[1].in_flight == 0);
+}
+
+TEST_CASE("tracer class") {
+  using namespace webview::detail;
+  auto &trace = tracer::instance();
+  trace.clear();
+  {
+    // Nothing is recorded while disabled.
+    trace_scope scope{"test", "disabled"};
+  }
+  trace.set_enabled(true);
+  {
+    trace_scope scope{"test", "scope", "1", "label"};
+  }
+  auto start = tracer::clock::now();
+  trace.record("test", "span", start, start + std::chrono::microseconds{5});
+  trace.set_enabled(false);
+
+  auto json = trace.to_json();
+  REQUIRE(json.find("\"disabled\"") == std::string::npos);
+  REQUIRE(json.find("{\"cat\":\"test\",\"name\":\"scope\",\"ph\":\"X\",") !=
+          std::string::npos);
+  REQUIRE(json.find("\"args\":{\"id\":\"1\",\"label\":\"label\"}") !=
+          std::string::npos);
+  REQUIRE(json.find("\"dur\":5.000,") != std::string::npos);
+  trace.clear();
+  REQUIRE(trace.to_json() == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}");
+
+  // Events of exited threads are kept until cleared.
+  trace.set_enabled(true);
+  std::thread{[&] {
+    trace.record("test", "thread", start, start + std::chrono::nanoseconds{1});
+  }}.join();
+  trace.set_enabled(false);
+  json = trace.to_json();
+  REQUIRE(json.find("\"name\":\"thread\"") != std::string::npos);
+  REQUIRE(json.find("\"dur\":0.001,") != std::string::npos);
+  trace.clear();
+  REQUIRE(trace.to_json() == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}");
+}
+
+TEST_CASE("stall_watchdog class") {
+  using namespace webview::detail;
+  struct report {
+    std::string site;
+    bool finished;
+  };
+  std::mutex mutex;
+  std::vector<report> reports;
+  stall_watchdog watchdog;
+  watchdog.start(
+      std::chrono::milliseconds{10},
+      [](std::function<void()> f) { f(); },
+      [&](const std::string &site, std::chrono::milliseconds duration,
+          bool finished) {
+        std::lock_guard<std::mutex> lock{mutex};
+        reports.push_back({site, finished});
+        (void)duration;
+      });
+  {
+    stall_watchdog::task_scope scope{watchdog, "binding", "fast"};
+  }
+  {
+    stall_watchdog::task_scope outer{watchdog, "dispatch", "function"};
+    stall_watchdog::task_scope inner{watchdog, "binding", "slow"};
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  }
+  // Wait for the report of the end of the stall.
+  for (int i = 0; i < 100; ++i) {
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (!reports.empty() && reports.back().finished) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  watchdog.stop();
+  REQUIRE(!reports.empty());
+  REQUIRE(reports.front().site == "binding slow");
+  REQUIRE(reports.back().site == "binding slow");
+  REQUIRE(reports.back().finished);
+
+  auto stats = watchdog.get_stats();
+  REQUIRE(stats.count == 1);
+  REQUIRE(stats.max_us >= 50000);
+  REQUIRE(stats.sites.size() == 1);
+  REQUIRE(stats.sites["binding slow"] == 1);
+
+  // Tasks aren't watched while stopped.
+  {
+    stall_watchdog::task_scope scope{watchdog, "binding", "slow"};
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  }
+  REQUIRE(watchdog.get_stats().count == 1);
+}
+
+TEST_CASE("loop_monitor class") {
+  using namespace webview::detail;
+  loop_monitor monitor;
+  {
+    // Nothing is measured while disabled.
+    loop_monitor::owned_scope scope{monitor};
+  }
+  REQUIRE(monitor.get_snapshot().owned_busy_ns == 0);
+  REQUIRE(monitor.get_snapshot().owned_share() == 0);
+
+  monitor.set_enabled(true);
+  {
+    loop_monitor::owned_scope outer{monitor};
+    loop_monitor::owned_scope inner{monitor};
+    std::this_thread::sleep_for(std::chrono::milliseconds{2});
+  }
+  monitor.record_iteration(std::chrono::milliseconds{4}, 3);
+  monitor.record_iteration(std::chrono::milliseconds{4}, 5);
+  auto stats = monitor.get_snapshot();
+  REQUIRE(stats.iterations == 2);
+  REQUIRE(stats.total_busy_ns == 8000000);
+  REQUIRE(stats.busy_ns.count() == 2);
+  REQUIRE(stats.pending_dispatches.max() == 5);
+  REQUIRE(stats.owned_busy_ns >= 2000000);
+  REQUIRE(stats.owned_share() ==
+          static_cast<double>(stats.owned_busy_ns) / 8000000);
+}
+
+TEST_CASE("null_engine class") {
+  using namespace webview::detail;
+  null_engine w;
+  REQUIRE(w.get_user_scripts().size() == 1);
+  REQUIRE(w.bind("add", [](const std::string &req) -> std::string {
+               return std::to_string(json_parse(req, "", 0)[0] -
+                                     json_parse(req, "", 1)[0]);
+             })
+              .ok());
+  // The bind script is added as a user script and the page is told about the
+  // new binding.
+  REQUIRE(w.get_user_scripts().size() == 2);
+  REQUIRE(w.take_scripts().size() == 1);
+
+  auto id = w.call("add", "[5,3]");
+  REQUIRE(w.take_scripts().empty());
+  REQUIRE(w.run_pending() > 0);
+  auto scripts = w.take_scripts();
+  REQUIRE(scripts.size() == 1);
+  // Arguments are passed in the order of their names: id, result, status.
+  auto reply = "(\"" + id + "\", \"2\", 0)";
+  REQUIRE(scripts[0].find("window.__webview__.onReply(") != std::string::npos);
+  REQUIRE(scripts[0].compare(scripts[0].size() - reply.size(), reply.size(),
+                             reply) == 0);
+
+  // Calls to unknown bindings are ignored.
+  w.call("unknown", "[]");
+  w.run_pending();
+  REQUIRE(w.take_scripts().empty());
+
+  std::size_t script_count{};
+  w.set_script_handler([&](const std::string &) { ++script_count; });
+  w.call("add", "[1,1]");
+  w.run_pending();
+  REQUIRE(script_count == 1);
+}
+
+TEST_CASE("null_engine event loop") {
+  using namespace webview::detail;
+  null_engine w;
+  int calls{};
+  REQUIRE(w.set_interval([&] { ++calls; }, 1).ok());
+  REQUIRE(w.set_timeout([&] { w.terminate(); }, 10).ok());
+  REQUIRE(w.run().ok());
+  REQUIRE(calls > 0);
+
+  // Dispatch from another thread wakes up the loop.
+  std::thread thread{[&] { w.dispatch([&] { w.terminate(); }); }};
+  REQUIRE(w.run().ok());
+  thread.join();
+
+  null_engine stepped;
+  REQUIRE(stepped.step(0).ok());
+  stepped.terminate();
+  REQUIRE(stepped.step(-1).error().code() == WEBVIEW_ERROR_CANCELED);
+}
+
+TEST_CASE("allocation_scope class") {
+  // Calls the allocation functions directly since the compiler may remove
+  // unused allocations made by new-expressions.
+  webview::allocation_scope scope;
+  REQUIRE(scope.stats().count == 0);
+  auto *value = ::operator new(sizeof(std::int64_t));
+  REQUIRE(scope.stats().count == 1);
+  REQUIRE(scope.stats().bytes == sizeof(std::int64_t));
+  {
+    webview::allocation_scope nested;
+    auto *chars = ::operator new[](100);
+    REQUIRE(nested.stats().count == 1);
+    REQUIRE(nested.stats().bytes == 100);
+    ::operator delete[](chars);
+  }
+  REQUIRE(scope.stats().count == 2);
+  ::operator delete(value);
+  if (webview::allocation_scope::counts_malloc()) {
+    void *(*volatile allocate)(std::size_t) = std::malloc;
+    auto *block = allocate(10);
+    REQUIRE(scope.stats().count == 3);
+    std::free(block);
+  }
+  // Allocations by other threads are not counted.
+  std::mutex mutex;
+  std::unique_lock<std::mutex> lock{mutex};
+  std::thread thread{[&] {
+    std::lock_guard<std::mutex> guard{mutex};
+    ::operator delete(::operator new(sizeof(int)));
+  }};
+  scope.reset();
+  lock.unlock();
+  thread.join();
+  REQUIRE(scope.stats().count == 0);
+}
+
+// Budgets are pinned for libstdc++ since other standard libraries use other
+// sizes for the small buffers of strings and functions and for container
+// nodes. Lower the budgets when removing allocations from these paths.
+#ifdef __GLIBCXX__
+TEST_CASE("Allocation budget of the IPC path") {
+  using namespace webview::detail;
+  null_engine w;
+  w.set_script_handler([](const std::string &) {});
+  REQUIRE(w.bind(
+               "noop", [](const std::string &, const std::string &, void *) {},
+               nullptr)
+              .ok());
+  const std::string message{R"({"id":"1","method":"noop","params":[1,2]})"};
+  // Averages over many calls after warming up, so that the amortized growth
+  // of queues does not make the count depend on the number of calls so far.
+  auto allocations_per_call = [](const std::function<void()> &fn) {
+    for (int i = 0; i < 16; ++i) {
+      fn();
+    }
+    const int calls{64};
+    webview::allocation_scope scope;
+    for (int i = 0; i < calls; ++i) {
+      fn();
+    }
+    return static_cast<double>(scope.stats().count) / calls;
+  };
+  auto on_message = allocations_per_call([&] {
+    w.post_message(message);
+    w.run_pending();
+  });
+  auto resolve = allocations_per_call([&] {
+    w.resolve("1", 0, "2");
+    w.run_pending();
+  });
+  auto dispatch = allocations_per_call([&] {
+    w.dispatch([] {});
+    w.run_pending();
+  });
+  REQUIRE(on_message <= 5);
+  REQUIRE(resolve <= 12);
+  REQUIRE(dispatch <= 2);
+}
+#endif
+
+TEST_CASE("asset_bundle class") {
+  using namespace webview::detail;
+  // A bundle with the file "a.txt" that contains "hello".
+  static const unsigned char data[] = {
+      // Header: magic, version, number of entries, reserved
+      'W', 'V', 'A', 'B', 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0,
+      // Index: path, MIME type, content, hash, flags, reserved
+      64, 0, 0, 0, 5, 0, 0, 0, 69, 0, 0, 0, 10, 0, 0, 0, //
+      80, 0, 0, 0, 0, 0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0,   //
+      1, 2, 3, 4, 5, 6, 7, 8, 0, 0, 0, 0, 0, 0, 0, 0,    //
+      // Strings
+      'a', '.', 't', 'x', 't', 't', 'e', 'x', 't', '/', 'p', 'l', 'a', 'i',
+      'n', 0,
+      // Content
+      'h', 'e', 'l', 'l', 'o'};
+
+  REQUIRE(asset_bundle::from_memory(data, 20).has_error());
+  REQUIRE(asset_bundle::from_memory(data + 1, sizeof(data) - 1).has_error());
+
+  auto bundle = asset_bundle::from_memory(data, sizeof(data)).value();
+  REQUIRE(bundle.entries().size() == 1);
+  REQUIRE(bundle.find("b.txt") == nullptr);
+  const auto *entry = bundle.find("a.txt");
+  REQUIRE(entry != nullptr);
+  REQUIRE(entry->mime_type == "text/plain");
+  REQUIRE(entry->encoding.empty());
+  REQUIRE(entry->etag == "\"0807060504030201\"");
+  REQUIRE(entry->data.to_string() == "hello");
+
+  scheme_request request;
+  request.path = "/a.txt";
+  auto response = bundle.serve(request);
+  REQUIRE(response.status == 200);
+  REQUIRE(response.content_type == "text/plain");
+  REQUIRE(response.body.to_string() == "hello");
+
+  request.headers["range"] = "bytes=1-3";
+  response = bundle.serve(request);
+  REQUIRE(response.status == 206);
+  REQUIRE(response.headers["Content-Range"] == "bytes 1-3/5");
+  REQUIRE(response.body.to_string() == "ell");
+
+  request.headers.clear();
+  request.headers["If-None-Match"] = entry->etag;
+  REQUIRE(bundle.serve(request).status == 304);
+
+  request.method = "POST";
+  REQUIRE(bundle.serve(request).status == 405);
+
+  request.method = "GET";
+  request.path = "/";
+  REQUIRE(bundle.serve(request).status == 404);
+
+  request.headers.clear();
+  request.path = "/%61.txt";
+  REQUIRE(bundle.serve(request).body.to_string() == "hello");
+  request.path = "/a%2";
+  REQUIRE(bundle.serve(request).status == 400);
+}
+
 TEST_CASE("optional class") {
   using namespace webview::detail;
 
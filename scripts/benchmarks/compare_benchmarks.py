@@ -0,0 +1,202 @@
+from argparse import ArgumentParser
+from dataclasses import dataclass
+import json
+import math
+import os
+import sys
+from typing import Dict, List, Optional, Sequence, Tuple
+
+# Fewer samples than this make the rank test meaningless.
+MIN_SAMPLES = 5
+
+
+@dataclass
+class Benchmark:
+    name: str
+    median_ns: float
+    samples: List[float]
+    allocs_per_iter: Optional[float]
+
+
+@dataclass
+class Comparison:
+    name: str
+    baseline_ns: float
+    current_ns: float
+    delta_percent: float
+    p_value: Optional[float]
+    status: str
+
+
+def load_benchmarks(path: os.PathLike) -> Dict[str, Benchmark]:
+    with open(path, encoding="utf-8") as f:
+        data = json.load(f)
+    benchmarks = {}
+    for entry in data["benchmarks"]:
+        benchmarks[entry["name"]] = Benchmark(
+            name=entry["name"],
+            median_ns=float(entry["median_ns"]),
+            samples=[float(x) for x in entry.get("sample_ns", [])],
+            allocs_per_iter=entry.get("allocs_per_iter"))
+    return benchmarks
+
+
+def mann_whitney_greater(current: Sequence[float],
+                         baseline: Sequence[float]) -> float:
+    """One-sided Mann-Whitney U test using the normal approximation with tie
+    and continuity correction.
+
+    Returns the p-value for the hypothesis that values in current tend to be
+    greater than values in baseline.
+    """
+    n1 = len(current)
+    n2 = len(baseline)
+    values = sorted([(x, 0) for x in current] + [(x, 1) for x in baseline])
+    n = n1 + n2
+    rank_sum = 0.0
+    tie_term = 0.0
+    i = 0
+    while i < n:
+        j = i
+        while j + 1 < n and values[j + 1][0] == values[i][0]:
+            j += 1
+        # Tied values share the average of their ranks (1-based).
+        rank = (i + j) / 2 + 1
+        ties = j - i + 1
+        tie_term += ties ** 3 - ties
+        rank_sum += rank * sum(1 for k in range(i, j + 1)
+                               if values[k][1] == 0)
+        i = j + 1
+    u = rank_sum - n1 * (n1 + 1) / 2
+    mean = n1 * n2 / 2
+    variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u - mean - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def compare(baseline: Benchmark, current: Benchmark, threshold: float,
+            alpha: float) -> Comparison:
+    delta = 0.0
+    if baseline.median_ns > 0:
+        delta = (current.median_ns - baseline.median_ns) \
+            / baseline.median_ns * 100
+    p_value = None
+    status = "no samples"
+    if len(baseline.samples) >= MIN_SAMPLES and \
+            len(current.samples) >= MIN_SAMPLES:
+        p_slower = mann_whitney_greater(current.samples, baseline.samples)
+        p_faster = mann_whitney_greater(baseline.samples, current.samples)
+        status = "unchanged"
+        if p_slower < alpha and delta > threshold:
+            status = "REGRESSION"
+            p_value = p_slower
+        elif p_faster < alpha and delta < -threshold:
+            status = "improvement"
+            p_value = p_faster
+        else:
+            p_value = min(p_slower, p_faster)
+    return Comparison(name=current.name,
+                      baseline_ns=baseline.median_ns,
+                      current_ns=current.median_ns,
+                      delta_percent=delta,
+                      p_value=p_value,
+                      status=status)
+
+
+def compare_allocations(baseline: Benchmark, current: Benchmark,
+                        allocs_threshold: float) -> Optional[str]:
+    # Allocation counts are deterministic enough to compare directly.
+    if baseline.allocs_per_iter is None or current.allocs_per_iter is None:
+        return None
+    increase = current.allocs_per_iter - baseline.allocs_per_iter
+    if increase > allocs_threshold:
+        return "{}: allocations per iteration increased from {:.2f} to {:.2f}" \
+            .format(current.name, baseline.allocs_per_iter,
+                    current.allocs_per_iter)
+    return None
+
+
+def format_ns(ns: float) -> str:
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "{:.2f} {}".format(ns / scale, unit)
+    return "{:.1f} ns".format(ns)
+
+
+def print_table(comparisons: Sequence[Comparison]):
+    print("{:<32} {:>12} {:>12} {:>9} {:>9}  {}".format(
+        "Benchmark", "Baseline", "Current", "Delta", "p-value", "Status"))
+    for c in comparisons:
+        p_value = "-" if c.p_value is None else "{:.4f}".format(c.p_value)
+        print("{:<32} {:>12} {:>12} {:>+8.1f}% {:>9}  {}".format(
+            c.name, format_ns(c.baseline_ns), format_ns(c.current_ns),
+            c.delta_percent, p_value, c.status))
+
+
+def run(baseline_path: os.PathLike, current_path: os.PathLike,
+        threshold: float, alpha: float,
+        allocs_threshold: float) -> Tuple[List[Comparison], List[str]]:
+    baseline = load_benchmarks(baseline_path)
+    current = load_benchmarks(current_path)
+    comparisons = []
+    problems = []
+    for name, bench in current.items():
+        if name not in baseline:
+            print("{}: not in baseline".format(name))
+            continue
+        comparison = compare(baseline[name], bench, threshold, alpha)
+        comparisons.append(comparison)
+        if comparison.status == "REGRESSION":
+            problems.append(
+                "{}: median time increased by {:.1f}% (p = {:.4f})".format(
+                    name, comparison.delta_percent, comparison.p_value))
+        allocations = compare_allocations(baseline[name], bench,
+                                          allocs_threshold)
+        if allocations:
+            problems.append(allocations)
+    for name in baseline:
+        if name not in current:
+            print("{}: missing from current results".format(name))
+    return comparisons, problems
+
+
+def main():
+    parser = ArgumentParser(
+        description="Compare benchmark results against a baseline. Exits "
+        "with status 1 when a benchmark is significantly slower.")
+    parser.add_argument("baseline", help="Baseline results (JSON)")
+    parser.add_argument("current", help="Current results (JSON)")
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=5.0,
+        help="Smallest change of the median in percent to report as a "
+        "regression or improvement (default: %(default)s)")
+    parser.add_argument(
+        "--alpha",
+        type=float,
+        default=0.01,
+        help="Significance level of the Mann-Whitney U test "
+        "(default: %(default)s)")
+    parser.add_argument(
+        "--allocs-threshold",
+        type=float,
+        default=0.5,
+        help="Largest tolerated increase of allocations per iteration "
+        "(default: %(default)s)")
+    args = parser.parse_args()
+
+    comparisons, problems = run(args.baseline, args.current, args.threshold,
+                                args.alpha, args.allocs_threshold)
+    print_table(comparisons)
+    if problems:
+        print()
+        for problem in problems:
+            print(problem)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -25,6 +25,9 @@
 #ifndef WEBVIEW_TEST_DRIVER_HH
 #define WEBVIEW_TEST_DRIVER_HH
 
+#include "webview/alloc_counter.hh"
+
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <map>
@@ -62,6 +65,25 @@ private:
   std::function<void()> m_fn;
 };
 
+// Counts heap allocations made by the current thread since the scope was
+// created or reset. See thread_allocation_stats() for what is counted.
+class allocation_scope {
+public:
+  allocation_scope() noexcept;
+
+  allocation_scope(const allocation_scope &) = delete;
+  allocation_scope &operator=(const allocation_scope &) = delete;
+
+  allocation_stats stats() const noexcept;
+  void reset() noexcept;
+
+  // Whether allocations through malloc are counted.
+  static bool counts_malloc() noexcept;
+
+private:
+  allocation_stats m_start;
+};
+
 struct auto_test_reg {
   explicit auto_test_reg(test_reg reg) noexcept {
     tests()[reg.name()] = std::move(reg);
@@ -31,6 +31,24 @@
 
 namespace webview {
 
+allocation_scope::allocation_scope() noexcept { reset(); }
+
+allocation_stats allocation_scope::stats() const noexcept {
+  allocation_stats stats;
+  auto now = thread_allocation_stats();
+  stats.count = now.count - m_start.count;
+  stats.bytes = now.bytes - m_start.bytes;
+  return stats;
+}
+
+void allocation_scope::reset() noexcept {
+  m_start = thread_allocation_stats();
+}
+
+bool allocation_scope::counts_malloc() noexcept {
+  return webview::counts_malloc();
+}
+
 std::map<std::string, test_reg> &auto_test_reg::tests() {
   static std::map<std::string, test_reg> instance;
   return instance;